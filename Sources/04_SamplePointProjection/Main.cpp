@@ -40,7 +40,7 @@ LRESULT CALLBACK WindowProcedure(HWND hWnd, UINT message, WPARAM wParam, LPARAM
 /**
  * Копирование информации о пикселях изображения в буфер "поверхности" окна
  * @param pixels Массив пикселей
- * @param width Ширина области
+ * @param width Ширина области (длина строки буфера в пикселях, может превышать видимую ширину)
  * @param height Высота области
  * @param hWnd Дескриптор окна
  */
@@ -186,7 +186,7 @@ int main(int argc, char* argv[])
             }
 
             // Показ кадра
-            PresentFrame(frameBuffer.getData(), static_cast<int>(frameBuffer.getWidth()), static_cast<int>(frameBuffer.getHeight()), g_hwnd);
+            PresentFrame(frameBuffer.getData(), static_cast<int>(frameBuffer.getPitch()), static_cast<int>(frameBuffer.getHeight()), g_hwnd);
         }
     }
     catch(std::exception& ex)
@@ -244,7 +244,7 @@ LRESULT CALLBACK WindowProcedure(HWND hWnd, UINT message, WPARAM wParam, LPARAM
 /**
  * Копирование информации о пикселях изображения в буфер "поверхности" окна
  * @param pixels Массив пикселей
- * @param width Ширина области
+ * @param width Ширина области (длина строки буфера в пикселях, может превышать видимую ширину)
  * @param height Высота области
  * @param hWnd Дескриптор окна
  */
@@ -44,7 +44,7 @@ LRESULT CALLBACK WindowProcedure(HWND hWnd, UINT message, WPARAM wParam, LPARAM
 /**
  * Копирование информации о пикселях изображения в буфер "поверхности" окна
  * @param pixels Массив пикселей
- * @param width Ширина области
+ * @param width Ширина области (длина строки буфера в пикселях, может превышать видимую ширину)
  * @param height Высота области
  * @param hWnd Дескриптор окна
  */
@@ -212,7 +212,7 @@ int main(int argc, char* argv[])
                     true);
 
             // Показ кадра
-            PresentFrame(frameBuffer.getData(), static_cast<int>(frameBuffer.getWidth()), static_cast<int>(frameBuffer.getHeight()), g_hwnd);
+            PresentFrame(frameBuffer.getData(), static_cast<int>(frameBuffer.getPitch()), static_cast<int>(frameBuffer.getHeight()), g_hwnd);
 
             // Очистка кадра
             frameBuffer.clear({0,0,0,0});
@@ -273,7 +273,7 @@ LRESULT CALLBACK WindowProcedure(HWND hWnd, UINT message, WPARAM wParam, LPARAM
 /**
  * Копирование информации о пикселях изображения в буфер "поверхности" окна
  * @param pixels Массив пикселей
- * @param width Ширина области
+ * @param width Ширина области (длина строки буфера в пикселях, может превышать видимую ширину)
  * @param height Высота области
  * @param hWnd Дескриптор окна
  */
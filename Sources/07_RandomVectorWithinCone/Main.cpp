@@ -8,6 +8,7 @@
 
 #include <Math.hpp>
 #include <Gfx.hpp>
+#include <LineBatch.hpp>
 
 /**
  * Коды ошибок
@@ -45,7 +46,7 @@ LRESULT CALLBACK WindowProcedure(HWND hWnd, UINT message, WPARAM wParam, LPARAM
 /**
  * Копирование информации о пикселях изображения в буфер "поверхности" окна
  * @param pixels Массив пикселей
- * @param width Ширина области
+ * @param width Ширина области (длина строки буфера в пикселях, может превышать видимую ширину)
  * @param height Высота области
  * @param hWnd Дескриптор окна
  */
@@ -217,7 +218,7 @@ int main(int argc, char* argv[])
             DrawLinePrimitives(&frameBuffer,linePointsTransformed,2);
 
             // Показ кадра
-            PresentFrame(frameBuffer.getData(), static_cast<int>(frameBuffer.getWidth()), static_cast<int>(frameBuffer.getHeight()), g_hwnd);
+            PresentFrame(frameBuffer.getData(), static_cast<int>(frameBuffer.getPitch()), static_cast<int>(frameBuffer.getHeight()), g_hwnd);
 
             // Очистка кадра
             frameBuffer.clear({0,0,0,0});
@@ -278,7 +279,7 @@ LRESULT CALLBACK WindowProcedure(HWND hWnd, UINT message, WPARAM wParam, LPARAM
 /**
  * Копирование информации о пикселях изображения в буфер "поверхности" окна
  * @param pixels Массив пикселей
- * @param width Ширина области
+ * @param width Ширина области (длина строки буфера в пикселях, может превышать видимую ширину)
  * @param height Высота области
  * @param hWnd Дескриптор окна
  */
@@ -330,6 +331,9 @@ void PresentFrame(void *pixels, int width, int height, HWND hWnd)
  */
 void DrawLinePrimitives(gfx::ImageBuffer<RGBQUAD>* imageBuffer, const std::vector<math::Vec2<float>> &projectedToNdcPoints, uint32_t pointsPerPrimitive)
 {
+    std::vector<gfx::Segment> segments;
+    segments.reserve(projectedToNdcPoints.size());
+
     for(size_t i = 0; i < projectedToNdcPoints.size(); i+=pointsPerPrimitive)
     {
         for(size_t j = i; j < i + pointsPerPrimitive; j++)
@@ -342,10 +346,13 @@ void DrawLinePrimitives(gfx::ImageBuffer<RGBQUAD>* imageBuffer, const std::vecto
             auto ps0 = math::NdcToScreen(projectedToNdcPoints[i0],imageBuffer->getWidth(),imageBuffer->getHeight());
             auto ps1 = math::NdcToScreen(projectedToNdcPoints[i1],imageBuffer->getWidth(),imageBuffer->getHeight());
 
-            // Нарисовать линию соединяющую точки
-            gfx::SetLine(imageBuffer,ps0.x,ps0.y,ps1.x,ps1.y,{0,255,0});
+            // Добавить линию соединяющую точки
+            segments.push_back({ps0.x,ps0.y,ps1.x,ps1.y});
         }
     }
+
+    // Нарисовать все линии одним вызовом (с отсечением границами буфера)
+    gfx::DrawLines(imageBuffer,segments.data(),segments.size(),{0,255,0});
 }
 
 /**
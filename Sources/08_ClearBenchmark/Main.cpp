@@ -0,0 +1,92 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+
+#include <Gfx.hpp>
+
+/**
+ * Замер среднего времени выполнения функции
+ * @tparam FN Тип функции
+ * @param fn Функция
+ * @param iterations Кол-во повторов
+ * @return Среднее время одного выполнения в миллисекундах
+ */
+template <typename FN>
+double Measure(FN&& fn, int iterations)
+{
+    // Первый (прогревочный) вызов не учитывается - в нем происходят промахи TLB и отображение страниц
+    fn();
+
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations; i++) fn();
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+}
+
+/**
+ * Сравнение способов очистки буфера заданного размера
+ * @tparam T Тип элемента буфера
+ * @param name Название теста
+ * @param width Ширина буфера
+ * @param height Высота буфера
+ * @param clearValue Значение для очистки
+ * @param threadPool Пул потоков
+ * @return Совпали ли результаты всех способов очистки
+ */
+template <typename T>
+bool Benchmark(const char* name, unsigned width, unsigned height, const T& clearValue, tools::ThreadPool& threadPool)
+{
+    const int iterations = 50;
+    gfx::ImageBuffer<T> buffer(width, height, T{});
+
+    // Исходный способ - обычное заполнение всего буфера
+    double fillTime = Measure([&]{
+        std::fill_n(buffer.getData(), buffer.getSize() / sizeof(T), clearValue);
+    }, iterations);
+
+    // Потоковая запись в одном потоке
+    double streamTime = Measure([&]{
+        buffer.clear(clearValue);
+    }, iterations);
+
+    // Потоковая запись в несколько потоков
+    double parallelTime = Measure([&]{
+        buffer.clear(clearValue, &threadPool);
+    }, iterations);
+
+    // Проверка результата
+    buffer.clear(T{});
+    buffer.clear(clearValue, &threadPool);
+    const T* data = buffer.getData();
+    bool valid = std::all_of(data, data + buffer.getSize() / sizeof(T), [&](const T& v){ return v == clearValue; });
+
+    std::cout << std::left << std::setw(24) << name
+              << std::right << std::fixed << std::setprecision(3)
+              << " fill_n: " << std::setw(8) << fillTime << " ms"
+              << "  stream: " << std::setw(8) << streamTime << " ms"
+              << "  stream x" << threadPool.getThreadCount() << ": " << std::setw(8) << parallelTime << " ms"
+              << (valid ? "" : "  [MISMATCH]") << std::endl;
+
+    return valid;
+}
+
+/**
+ * Точка входа
+ * @return Код выполнения (0 - результаты всех способов очистки совпали)
+ */
+int main()
+{
+    tools::ThreadPool threadPool;
+    bool valid = true;
+
+    valid &= Benchmark<uint32_t>("1920x1080 color (32b)", 1920, 1080, 0xFF202020u, threadPool);
+    valid &= Benchmark<float>("1920x1080 depth (float)", 1920, 1080, 1.0f, threadPool);
+    valid &= Benchmark<uint32_t>("3840x2160 color (32b)", 3840, 2160, 0xFF202020u, threadPool);
+    valid &= Benchmark<float>("3840x2160 depth (float)", 3840, 2160, 1.0f, threadPool);
+    valid &= Benchmark<uint64_t>("3840x2160 color (64b)", 3840, 2160, 0x0123456789ABCDEFull, threadPool);
+
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,116 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdlib>
+#include <algorithm>
+
+#include <Gfx.hpp>
+#include <Rasterizer.hpp>
+#include <TiledRasterizer.hpp>
+#include <SwapChain.hpp>
+#include <HeadlessPresenter.hpp>
+#include <FrameWriter.hpp>
+#include <CubeGrid.hpp>
+
+/// Тип пикселя кадра
+using Pixel = gfx::PixelBGRA;
+
+/**
+ * Точка входа (отрисовка без дисплея)
+ * @details Аргументы: [кол-во кадров] [ширина] [высота] [префикс пути сохраняемых кадров] [сохранять каждый N-й кадр]
+ * [путь к файлу видео Y4M (все кадры, без потерь)] [кол-во потоков растеризации, 0 - по кол-ву ядер, 1 - без тайлов]
+ * @param argc Кол-во аргументов
+ * @param argv Аргументы
+ * @return Код исполнения
+ */
+int main(int argc, char* argv[])
+{
+    const unsigned frameCount = argc > 1 ? static_cast<unsigned>(std::strtoul(argv[1], nullptr, 10)) : 300;
+    const unsigned width = argc > 2 ? static_cast<unsigned>(std::strtoul(argv[2], nullptr, 10)) : 1280;
+    const unsigned height = argc > 3 ? static_cast<unsigned>(std::strtoul(argv[3], nullptr, 10)) : 720;
+    const std::string dumpPrefix = argc > 4 ? argv[4] : "";
+    const unsigned dumpInterval = argc > 5 ? static_cast<unsigned>(std::strtoul(argv[5], nullptr, 10)) : (dumpPrefix.empty() ? 0 : 60);
+    const std::string videoPath = argc > 6 ? argv[6] : "";
+    const unsigned threadCount = argc > 7 ? static_cast<unsigned>(std::strtoul(argv[7], nullptr, 10)) : 0;
+
+    if(width == 0 || height == 0){
+        std::cout << "ERROR: Invalid frame size." << std::endl;
+        return 1;
+    }
+
+    const Pixel clearColor = {32, 16, 16, 255};
+
+    // Вывод без дисплея и цепочка буферов (вывод и сохранение кадров идут в отдельном потоке)
+    gfx::HeadlessPresenter<Pixel> presenter(dumpPrefix, dumpInterval);
+
+    // Запись видео в фоновом потоке (для эталонных последовательностей кадры не отбрасываются)
+    std::unique_ptr<gfx::FrameWriter<Pixel>> videoWriter;
+    if(!videoPath.empty()){
+        videoWriter.reset(new gfx::FrameWriter<Pixel>(videoPath, width, height, gfx::FrameFormat::eY4M, 8, gfx::FrameOverflow::eWait));
+    }
+
+    gfx::SwapChain<Pixel> swapChain(width, height, clearColor, [&](const gfx::ImageBuffer<Pixel>& frame){
+        presenter.present(frame);
+        if(videoWriter) videoWriter->present(frame);
+    });
+
+    std::cout << "INFO: Rendering " << frameCount << " frames at " << width << "x" << height
+              << " (" << swapChain.getBufferCount() << " buffers)" << std::endl;
+
+    // Сцена рисуется с тестом глубины: тайловым растеризатором (тайлы делятся между потоками пула) или, при одном
+    // потоке, обычным растеризатором прямо в буфер кадра
+    samples::CubeGrid scene;
+    gfx::ImageBuffer<float> depthBuffer(width, height, 1.0f);
+    tools::ThreadPool threadPool(threadCount);
+    const bool tiled = threadPool.getThreadCount() > 1;
+    const float aspectRatio = static_cast<float>(width) / static_cast<float>(height);
+
+    auto* frameBuffer = &swapChain.getBackBuffer();
+    auto rasterizer = gfx::MakeRasterizer<samples::MeshVertex, Pixel, float>(
+            frameBuffer, &depthBuffer, scene.getVertexShader(), scene.getFragmentShader());
+    auto tiledRasterizer = gfx::MakeTiledRasterizer<samples::MeshVertex, Pixel, float>(
+            frameBuffer, &depthBuffer, scene.getVertexShader(), scene.getFragmentShader(), &threadPool);
+
+    std::cout << "INFO: Rasterizer: " << (tiled ? "tiled" : "immediate") << " (" << threadPool.getThreadCount()
+              << " threads)" << std::endl;
+
+    double renderMs = 0.0;
+
+    for(unsigned frame = 0; frame < frameCount; frame++)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        frameBuffer->clear(clearColor);
+        depthBuffer.clearDeferred(1.0f);
+
+        // Сетка вращающихся кубов
+        if(tiled){
+            tiledRasterizer.setColorBuffer(frameBuffer);
+            scene.draw(tiledRasterizer, frame, aspectRatio);
+            tiledRasterizer.Flush();
+        }
+        else{
+            rasterizer.setColorBuffer(frameBuffer);
+            scene.draw(rasterizer, frame, aspectRatio);
+        }
+
+        renderMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        frameBuffer = &swapChain.present();
+    }
+
+    swapChain.waitIdle();
+    if(videoWriter){
+        videoWriter->flush();
+        std::cout << "INFO: Video frames written: " << videoWriter->getWrittenCount() << std::endl;
+    }
+
+    std::cout << "INFO: Render time per frame: " << std::fixed << std::setprecision(3)
+              << (frameCount > 0 ? renderMs / frameCount : 0.0) << " ms" << std::endl;
+    std::cout << "INFO: Presented ";
+    presenter.report(std::cout);
+
+    return 0;
+}
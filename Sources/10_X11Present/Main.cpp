@@ -0,0 +1,85 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+
+#include <Gfx.hpp>
+#include <TiledRasterizer.hpp>
+#include <SwapChain.hpp>
+#include <X11Presenter.hpp>
+#include <Timer.hpp>
+#include <CubeGrid.hpp>
+
+/// Тип пикселя кадра
+using Pixel = gfx::PixelBGRA;
+
+/**
+ * Точка входа (вывод в окно X11 через разделяемую память)
+ * @details Аргументы: [ширина] [высота] [кол-во кадров, 0 - до закрытия окна]
+ * @param argc Кол-во аргументов
+ * @param argv Аргументы
+ * @return Код исполнения
+ */
+int main(int argc, char* argv[])
+{
+    const unsigned width = argc > 1 ? static_cast<unsigned>(std::strtoul(argv[1], nullptr, 10)) : 800;
+    const unsigned height = argc > 2 ? static_cast<unsigned>(std::strtoul(argv[2], nullptr, 10)) : 600;
+    const unsigned frameCount = argc > 3 ? static_cast<unsigned>(std::strtoul(argv[3], nullptr, 10)) : 0;
+
+    if(width == 0 || height == 0){
+        std::cout << "ERROR: Invalid frame size." << std::endl;
+        return 1;
+    }
+
+    const Pixel clearColor = {32, 16, 16, 255};
+
+    try
+    {
+        // Окно и цепочка буферов в разделяемой памяти (рисование идет прямо в память, которую читает X-сервер)
+        gfx::X11ShmPresenter<Pixel> presenter(width, height, "X11 MIT-SHM Present");
+        gfx::SwapChain<Pixel, gfx::LinearLayout, gfx::SharedMemoryStorage> swapChain(width, height, clearColor, gfx::MakePresentFn(presenter));
+
+        // Поверхности всех буферов создаются до начала вывода
+        for(unsigned i = 0; i < swapChain.getBufferCount(); i++) presenter.attach(swapChain.getBuffer(i));
+
+        std::cout << "INFO: X11 presenter initialized (resolution : " << width << "x" << height
+                  << ", MIT-SHM : " << (presenter.isUsingShm() ? "yes" : "no") << ")" << std::endl;
+
+        // Сцена рисуется тайловым растеризатором с тестом глубины (тайлы делятся между потоками пула)
+        samples::CubeGrid scene;
+        gfx::ImageBuffer<float> depthBuffer(width, height, 1.0f);
+        tools::ThreadPool threadPool;
+        const float aspectRatio = static_cast<float>(width) / static_cast<float>(height);
+
+        tools::Timer timer;
+        auto* frameBuffer = &swapChain.getBackBuffer();
+        auto rasterizer = gfx::MakeTiledRasterizer<samples::MeshVertex, Pixel, float>(
+                frameBuffer, &depthBuffer, scene.getVertexShader(), scene.getFragmentShader(), &threadPool);
+
+        for(unsigned frame = 0; presenter.isOpen() && (frameCount == 0 || frame < frameCount); frame++)
+        {
+            timer.updateTimer();
+            if(timer.isFpsCounterReady()) std::cout << "INFO: " << timer.getFps() << " FPS" << std::endl;
+
+            frameBuffer->clear(clearColor);
+            depthBuffer.clearDeferred(1.0f);
+
+            // Сетка вращающихся кубов
+            rasterizer.setColorBuffer(frameBuffer);
+            scene.draw(rasterizer, frame, aspectRatio);
+            rasterizer.Flush();
+
+            frameBuffer = &swapChain.present();
+        }
+
+        swapChain.waitIdle();
+    }
+    catch(std::exception& ex)
+    {
+        std::cout << ex.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,129 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <cstdint>
+
+#include <Gfx.hpp>
+#include <Pixel.hpp>
+#include <SwapChain.hpp>
+#include <SharedFrameRing.hpp>
+
+/// Тип пикселя кадра
+using Pixel = gfx::PixelBGRA;
+
+/**
+ * Публикация кадров в кольцо (процесс отрисовки)
+ * @param name Имя объекта разделяемой памяти
+ * @param frameCount Кол-во кадров
+ * @param width Ширина кадра
+ * @param height Высота кадра
+ * @return Код исполнения
+ */
+int RunWriter(const std::string& name, unsigned frameCount, unsigned width, unsigned height)
+{
+    gfx::SharedFrameRing<Pixel> ring(name, width, height, 4);
+    gfx::SwapChain<Pixel> swapChain(width, height, {0, 0, 0, 255}, gfx::MakePresentFn(ring));
+
+    std::cout << "INFO: Publishing " << frameCount << " frames (" << width << "x" << height << ") to /dev/shm" << name << std::endl;
+
+    auto* frameBuffer = &swapChain.getBackBuffer();
+    for(unsigned frame = 0; frame < frameCount; frame++)
+    {
+        frameBuffer->clear({0, 0, 0, 255});
+
+        // Движущаяся полоса и номер кадра в первом пикселе (для проверки читателем)
+        int x = static_cast<int>(frame * 4 % width);
+        gfx::SetBox(frameBuffer, x, 0, x + 16, static_cast<int>(height) - 1, {255, 128, 0, 255});
+        (*frameBuffer)[0][0] = {static_cast<uint8_t>(frame), static_cast<uint8_t>(frame >> 8u), static_cast<uint8_t>(frame >> 16u), 255};
+
+        frameBuffer = &swapChain.present();
+
+        // Примерно 120 кадров в секунду
+        std::this_thread::sleep_for(std::chrono::microseconds(8333));
+    }
+
+    swapChain.waitIdle();
+    std::cout << "INFO: Published: " << ring.getWrittenCount() << ", dropped (unread by primary reader): " << ring.getDroppedCount() << std::endl;
+    return 0;
+}
+
+/**
+ * Чтение кадров из кольца (другой процесс)
+ * @param name Имя объекта разделяемой памяти
+ * @param delayMs Имитация медленной обработки кадра (мс)
+ * @return Код исполнения
+ */
+int RunReader(const std::string& name, unsigned delayMs)
+{
+    gfx::SharedFrameRingReader<Pixel> reader(name);
+    std::cout << "INFO: Attached to /dev/shm" << name << " (" << reader.getWidth() << "x" << reader.getHeight() << ")" << std::endl;
+
+    uint64_t received = 0;
+    uint64_t torn = 0;
+
+    // Чтение до тех пор, пока кадры приходят (пауза больше секунды - конец потока)
+    while(reader.wait(1000))
+    {
+        gfx::SharedFrame<Pixel> frame;
+        if(!reader.acquire(frame)) continue;
+
+        // Обработка прямо в разделяемой памяти, затем проверка, что слот не перезаписан
+        const Pixel marker = frame.view[0][0];
+        if(delayMs > 0) std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+
+        if(reader.validate(frame)) received++;
+        else torn++;
+
+        if(received % 60 == 0 && received > 0){
+            std::cout << "INFO: frame " << frame.sequence << " (marker " << (marker.b | (marker.g << 8u) | (marker.r << 16u)) << ")"
+                      << ", received: " << received << ", overwritten while reading: " << torn
+                      << ", dropped: " << reader.getDroppedCount() << std::endl;
+        }
+    }
+
+    std::cout << "INFO: Received: " << received << ", overwritten while reading: " << torn
+              << ", dropped: " << reader.getDroppedCount() << " of " << reader.getWrittenCount() << std::endl;
+    return 0;
+}
+
+/**
+ * Точка входа
+ * @details Аргументы: write <имя> [кол-во кадров] [ширина] [высота] | read <имя> [задержка обработки кадра, мс]
+ * @param argc Кол-во аргументов
+ * @param argv Аргументы
+ * @return Код исполнения
+ */
+int main(int argc, char* argv[])
+{
+    if(argc < 3){
+        std::cout << "Usage: " << argv[0] << " write <name> [frames] [width] [height]" << std::endl;
+        std::cout << "       " << argv[0] << " read <name> [processing delay, ms]" << std::endl;
+        return 1;
+    }
+
+    const std::string mode = argv[1];
+    const std::string name = argv[2][0] == '/' ? argv[2] : std::string("/") + argv[2];
+
+    try
+    {
+        if(mode == "write"){
+            return RunWriter(name,
+                             argc > 3 ? static_cast<unsigned>(std::strtoul(argv[3], nullptr, 10)) : 600,
+                             argc > 4 ? static_cast<unsigned>(std::strtoul(argv[4], nullptr, 10)) : 640,
+                             argc > 5 ? static_cast<unsigned>(std::strtoul(argv[5], nullptr, 10)) : 360);
+        }
+        if(mode == "read"){
+            return RunReader(name, argc > 3 ? static_cast<unsigned>(std::strtoul(argv[3], nullptr, 10)) : 0);
+        }
+    }
+    catch(std::exception& ex)
+    {
+        std::cout << ex.what() << std::endl;
+        return 1;
+    }
+
+    std::cout << "ERROR: Unknown mode: " << mode << std::endl;
+    return 1;
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GFX_COVERAGE_SSE2
+#endif
+
+namespace gfx
+{
+    /// Размер стороны блока, которыми обходится треугольник при вычислении покрытия
+    constexpr int kCoverageBlockSize = 8;
+
+    /// Маска полностью покрытого блока (по биту на пиксель, строка за строкой)
+    constexpr uint64_t kCoverageFullMask = ~0ull;
+
+    /**
+     * Уравнение грани треугольника E(x,y) = a*x + b*y + c в координатах пикселей
+     * @details Точка принадлежит треугольнику если для всех трех граней E >= 0
+     * (правило заполнения учитывается заранее смещением коэффициента c)
+     */
+    struct EdgeEquation
+    {
+        int64_t a;
+        int64_t b;
+        int64_t c;
+    };
+
+    /**
+     * Маска покрытия 8 подряд идущих пикселей строки (скалярный вариант)
+     * @param e Значения уравнений граней в первом пикселе
+     * @param a Шаги уравнений граней по X
+     * @param count Кол-во проверяемых граней
+     * @return Маска (бит на пиксель)
+     */
+    inline uint32_t CoverageRowMaskScalar(const int64_t* e, const int64_t* a, int count)
+    {
+        uint32_t mask = 0;
+        for(int i = 0; i < kCoverageBlockSize; i++)
+        {
+            bool inside = true;
+            for(int k = 0; k < count; k++){
+                inside = inside && (e[k] + a[k] * i) >= 0;
+            }
+            if(inside) mask |= (1u << static_cast<unsigned>(i));
+        }
+        return mask;
+    }
+
+    /**
+     * Маска покрытия 8 подряд идущих пикселей строки
+     * @details Значения уравнений обязаны помещаться в 32 бита (выполняется для частично покрытых блоков,
+     * если шаги уравнений не слишком велики - см. RasterizeCoverageBlocks)
+     * @param e Значения уравнений граней в первом пикселе
+     * @param a Шаги уравнений граней по X
+     * @param count Кол-во проверяемых граней
+     * @return Маска (бит на пиксель)
+     */
+    inline uint32_t CoverageRowMask(const int64_t* e, const int64_t* a, int count)
+    {
+#if defined(__AVX2__)
+        const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        __m256i combined = _mm256_setzero_si256();
+        for(int k = 0; k < count; k++){
+            __m256i values = _mm256_add_epi32(
+                    _mm256_set1_epi32(static_cast<int32_t>(e[k])),
+                    _mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int32_t>(a[k])), lanes));
+            combined = _mm256_or_si256(combined, values);
+        }
+        return ~static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(combined))) & 0xFFu;
+#elif defined(GFX_COVERAGE_SSE2)
+        __m128i combinedLo = _mm_setzero_si128();
+        __m128i combinedHi = _mm_setzero_si128();
+        for(int k = 0; k < count; k++){
+            auto e0 = static_cast<int32_t>(e[k]);
+            auto step = static_cast<int32_t>(a[k]);
+            __m128i lo = _mm_setr_epi32(e0, e0 + step, e0 + step * 2, e0 + step * 3);
+            __m128i hi = _mm_add_epi32(lo, _mm_set1_epi32(step * 4));
+            combinedLo = _mm_or_si128(combinedLo, lo);
+            combinedHi = _mm_or_si128(combinedHi, hi);
+        }
+        auto signs = static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(combinedLo))) |
+                     (static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(combinedHi))) << 4u);
+        return ~signs & 0xFFu;
+#else
+        return CoverageRowMaskScalar(e, a, count);
+#endif
+    }
+
+    /**
+     * Обход треугольника блоками 8x8 с иерархическим отбрасыванием
+     * @details Для каждого блока по угловым значениям уравнений граней определяется, лежит ли блок целиком вне
+     * треугольника (отбрасывается), целиком внутри (принимается без попиксельной проверки) или пересекается гранями.
+     * Для пересекаемых блоков покрытие вычисляется построчно по 8 пикселей (SSE2/AVX2, при отсутствии - скалярно),
+     * причем проверяются только грани, которые действительно пересекают блок.
+     * @tparam BLOCK_FN Функтор вида void(int x, int y, uint64_t mask), где (x,y) - левый верхний пиксель блока,
+     * mask - покрытие (бит row*8+col), kCoverageFullMask - блок покрыт полностью
+     * @param edges Три уравнения граней
+     * @param minX Левая граница области (включительно)
+     * @param minY Верхняя граница области (включительно)
+     * @param maxX Правая граница области (включительно)
+     * @param maxY Нижняя граница области (включительно)
+     * @param blockFn Функтор обработки покрытых блоков
+     */
+    template <typename BLOCK_FN>
+    void RasterizeCoverageBlocks(const EdgeEquation* edges, int minX, int minY, int maxX, int maxY, BLOCK_FN&& blockFn)
+    {
+        if(minX > maxX || minY > maxY) return;
+
+        constexpr int last = kCoverageBlockSize - 1;
+
+        // Векторная проверка возможна, если значения уравнений в пересекаемом гранью блоке помещаются в 32 бита
+        bool vectorSafe = true;
+        for(int k = 0; k < 3; k++){
+            if(std::llabs(edges[k].a) >= (1ll << 26) || std::llabs(edges[k].b) >= (1ll << 26)) vectorSafe = false;
+        }
+
+        // Смещения до угла блока с наибольшим и наименьшим значением уравнения
+        int64_t maxOffset[3], minOffset[3];
+        for(int k = 0; k < 3; k++){
+            maxOffset[k] = std::max<int64_t>(edges[k].a, 0) * last + std::max<int64_t>(edges[k].b, 0) * last;
+            minOffset[k] = std::min<int64_t>(edges[k].a, 0) * last + std::min<int64_t>(edges[k].b, 0) * last;
+        }
+
+        // Сетка блоков выравнивается по кратным размеру блока координатам
+        int startX = minX & ~last;
+        int startY = minY & ~last;
+
+        for(int by = startY; by <= maxY; by += kCoverageBlockSize)
+        {
+            // Строки блока, лежащие в пределах области
+            uint64_t rowClip = kCoverageFullMask;
+            if(by < minY) rowClip &= kCoverageFullMask << static_cast<unsigned>((minY - by) * kCoverageBlockSize);
+            if(by + last > maxY) rowClip &= kCoverageFullMask >> static_cast<unsigned>((by + last - maxY) * kCoverageBlockSize);
+
+            for(int bx = startX; bx <= maxX; bx += kCoverageBlockSize)
+            {
+                // Столбцы блока, лежащие в пределах области
+                uint64_t clip = rowClip;
+                if(bx < minX || bx + last > maxX)
+                {
+                    uint32_t columns = 0xFFu;
+                    if(bx < minX) columns &= (0xFFu << static_cast<unsigned>(minX - bx)) & 0xFFu;
+                    if(bx + last > maxX) columns &= 0xFFu >> static_cast<unsigned>(bx + last - maxX);
+                    clip &= columns * 0x0101010101010101ull;
+                }
+
+                // Значения уравнений в левом верхнем пикселе блока
+                int64_t origin[3];
+                bool rejected = false;
+                int partialEdges[3];
+                int partialCount = 0;
+
+                for(int k = 0; k < 3; k++)
+                {
+                    origin[k] = edges[k].a * bx + edges[k].b * by + edges[k].c;
+
+                    // Весь блок снаружи от грани - отбросить
+                    if(origin[k] + maxOffset[k] < 0){
+                        rejected = true;
+                        break;
+                    }
+
+                    // Грань пересекает блок - потребуется попиксельная проверка
+                    if(origin[k] + minOffset[k] < 0) partialEdges[partialCount++] = k;
+                }
+
+                if(rejected) continue;
+
+                // Блок целиком внутри
+                if(partialCount == 0){
+                    blockFn(bx, by, clip);
+                    continue;
+                }
+
+                // Частичное покрытие - проверить пиксели построчно
+                int64_t rowValues[3], steps[3];
+                for(int i = 0; i < partialCount; i++){
+                    rowValues[i] = origin[partialEdges[i]];
+                    steps[i] = edges[partialEdges[i]].a;
+                }
+
+                uint64_t mask = 0;
+                for(int row = 0; row < kCoverageBlockSize; row++)
+                {
+                    uint32_t rowMask = vectorSafe ?
+                            CoverageRowMask(rowValues, steps, partialCount) :
+                            CoverageRowMaskScalar(rowValues, steps, partialCount);
+
+                    mask |= static_cast<uint64_t>(rowMask) << static_cast<unsigned>(row * kCoverageBlockSize);
+
+                    for(int i = 0; i < partialCount; i++) rowValues[i] += edges[partialEdges[i]].b;
+                }
+
+                mask &= clip;
+                if(mask != 0) blockFn(bx, by, mask);
+            }
+        }
+    }
+}
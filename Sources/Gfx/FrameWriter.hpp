@@ -0,0 +1,436 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <system_error>
+#include <cerrno>
+#include <cstdio>
+#include <cstdint>
+
+#if defined(_WIN32)
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#endif
+
+#include "Presenter.hpp"
+#include "Pixel.hpp"
+
+namespace gfx
+{
+    /**
+     * Формат потока кадров
+     */
+    enum class FrameFormat
+    {
+        /// Пиксели RGBA8 подряд, без заголовков (размер кадра - ширина * высота * 4 байта)
+        eRawRGBA,
+        /// YUV4MPEG2 4:2:0 (C420jpeg, полный диапазон BT.601) - принимается большинством кодировщиков со стандартного входа
+        eY4M
+    };
+
+    /**
+     * Поведение при заполненной очереди кадров
+     */
+    enum class FrameOverflow
+    {
+        /// Отбросить кадр (вывод никогда не ждет записи, отброшенные кадры считаются)
+        eDrop,
+        /// Дождаться освобождения места в очереди (без потерь, для захвата эталонных последовательностей)
+        eWait
+    };
+
+    /**
+     * Запись кадров в файл или канал (например на вход кодировщика) в фоновом потоке
+     * @details present только копирует пиксели кадра в свободный слот ограниченной очереди (память слотов выделяется
+     * один раз) и возвращается, а преобразование формата и запись в дескриптор выполняет поток записи, поэтому медленный
+     * носитель или кодировщик не задерживает отрисовку. При заполненной очереди кадр отбрасывается (FrameOverflow::eDrop)
+     * или present ждет места (FrameOverflow::eWait). Ошибка записи останавливает запись, код ошибки - getError().
+     * В потоке записи сигнал SIGPIPE заблокирован: если читатель канала завершился (например кодировщик), процесс не
+     * завершается, а запись останавливается с ошибкой EPIPE.
+     *
+     * Деструктор дописывает кадры, оставшиеся в очереди.
+     * @tparam T Тип пикселей (требуется специализация PixelTraits<T>)
+     * @tparam LAYOUT Расположение пикселей в буфере кадра
+     * @tparam STORAGE Хранилище пикселей буфера кадра
+     */
+    template<typename T, typename LAYOUT = LinearLayout, typename STORAGE = HeapStorage>
+    class FrameWriter : public Presenter<T, LAYOUT, STORAGE>
+    {
+    public:
+        using typename Presenter<T, LAYOUT, STORAGE>::Buffer;
+
+    private:
+        /// Дескриптор вывода
+        int fd_;
+        /// Закрывать ли дескриптор при разрушении
+        bool ownsFd_;
+        /// Формат потока
+        FrameFormat format_;
+        /// Поведение при заполненной очереди
+        FrameOverflow overflow_;
+        /// Кадров в секунду (для заголовка Y4M)
+        unsigned frameRate_;
+
+        unsigned width_;
+        unsigned height_;
+
+        /// Слоты очереди (линейные кадры)
+        std::vector<std::vector<T>> slots_;
+        /// Индекс первого занятого слота
+        size_t head_ = 0;
+        /// Кол-во занятых слотов
+        size_t count_ = 0;
+
+        std::mutex mutex_;
+        /// Сигнал потоку записи (появился кадр)
+        std::condition_variable frameReady_;
+        /// Сигнал выводу (освободился слот)
+        std::condition_variable slotFree_;
+        bool stop_ = false;
+
+        std::atomic<uint64_t> writtenCount_{0};
+        std::atomic<uint64_t> droppedCount_{0};
+        std::atomic<int> error_{0};
+
+        /// Поток записи
+        std::thread writerThread_;
+
+#if !defined(_WIN32)
+        /**
+         * Набор сигналов, содержащий только SIGPIPE
+         * @return Набор сигналов
+         */
+        static sigset_t pipeSignalSet()
+        {
+            sigset_t set;
+            sigemptyset(&set);
+            sigaddset(&set, SIGPIPE);
+            return set;
+        }
+
+        /**
+         * Забрать ожидающий сигнал SIGPIPE, сгенерированный записью в закрытый канал (сигнал заблокирован в потоке записи)
+         */
+        static void consumePipeSignal()
+        {
+            sigset_t pending;
+            if(sigpending(&pending) != 0 || !sigismember(&pending, SIGPIPE)) return;
+
+            const sigset_t set = pipeSignalSet();
+            int received = 0;
+            sigwait(&set, &received);
+        }
+#endif
+
+        /**
+         * Записать блок данных полностью
+         * @param data Данные
+         * @param size Размер в байтах
+         * @return Удалось ли записать
+         */
+        bool writeAll(const uint8_t* data, size_t size)
+        {
+            while(size > 0)
+            {
+#if defined(_WIN32)
+                int written = _write(fd_, data, static_cast<unsigned>(std::min<size_t>(size, 1u << 30u)));
+#else
+                ssize_t written = ::write(fd_, data, size);
+#endif
+                if(written < 0){
+                    const int error = errno;
+                    if(error == EINTR) continue;
+#if !defined(_WIN32)
+                    if(error == EPIPE) consumePipeSignal();
+#endif
+                    error_.store(error);
+                    return false;
+                }
+                data += written;
+                size -= static_cast<size_t>(written);
+            }
+            return true;
+        }
+
+        /**
+         * Преобразовать кадр в формат потока
+         * @param frame Линейный кадр
+         * @param out Данные кадра в формате потока
+         */
+        void encode(const std::vector<T>& frame, std::vector<uint8_t>& out) const
+        {
+            const size_t pixelCount = static_cast<size_t>(width_) * height_;
+
+            if(format_ == FrameFormat::eRawRGBA){
+                out.resize(pixelCount * 4);
+                for(size_t i = 0; i < pixelCount; i++) PixelTraits<T>::ToRGBA8(frame[i], out.data() + i * 4);
+                return;
+            }
+
+            // Y4M: заголовок кадра, плоскость Y, плоскости U и V с половинным разрешением
+            static const char kFrameHeader[] = "FRAME\n";
+            const size_t headerSize = sizeof(kFrameHeader) - 1;
+            const unsigned chromaWidth = (width_ + 1) / 2;
+            const unsigned chromaHeight = (height_ + 1) / 2;
+            const size_t chromaSize = static_cast<size_t>(chromaWidth) * chromaHeight;
+
+            out.resize(headerSize + pixelCount + chromaSize * 2);
+            std::copy(kFrameHeader, kFrameHeader + headerSize, out.data());
+            uint8_t* planeY = out.data() + headerSize;
+            uint8_t* planeU = planeY + pixelCount;
+            uint8_t* planeV = planeU + chromaSize;
+
+            for(unsigned cy = 0; cy < chromaHeight; cy++)
+            {
+                for(unsigned cx = 0; cx < chromaWidth; cx++)
+                {
+                    // Блок 2x2 пикселей: яркость для каждого, цветность - среднее по блоку (фиксированная точка, 16 бит)
+                    int sumU = 0, sumV = 0, samples = 0;
+                    for(unsigned dy = 0; dy < 2; dy++)
+                    {
+                        unsigned y = cy * 2 + dy;
+                        if(y >= height_) break;
+                        for(unsigned dx = 0; dx < 2; dx++)
+                        {
+                            unsigned x = cx * 2 + dx;
+                            if(x >= width_) break;
+
+                            uint8_t rgba[4];
+                            PixelTraits<T>::ToRGBA8(frame[static_cast<size_t>(y) * width_ + x], rgba);
+                            const int r = rgba[0], g = rgba[1], b = rgba[2];
+
+                            planeY[static_cast<size_t>(y) * width_ + x] = static_cast<uint8_t>((19595 * r + 38470 * g + 7471 * b + 32768) >> 16);
+                            sumU += -11059 * r - 21709 * g + 32768 * b;
+                            sumV += 32768 * r - 27439 * g - 5329 * b;
+                            samples++;
+                        }
+                    }
+
+                    const size_t c = static_cast<size_t>(cy) * chromaWidth + cx;
+                    planeU[c] = static_cast<uint8_t>(std::min(std::max((sumU / samples + (128 << 16) + 32768) >> 16, 0), 255));
+                    planeV[c] = static_cast<uint8_t>(std::min(std::max((sumV / samples + (128 << 16) + 32768) >> 16, 0), 255));
+                }
+            }
+        }
+
+        /**
+         * Цикл потока записи
+         */
+        void writerLoop()
+        {
+#if !defined(_WIN32)
+            // Запись в закрытый канал должна возвращать EPIPE, а не завершать процесс сигналом
+            const sigset_t pipeSet = pipeSignalSet();
+            pthread_sigmask(SIG_BLOCK, &pipeSet, nullptr);
+#endif
+
+            std::vector<uint8_t> encoded;
+
+            if(format_ == FrameFormat::eY4M){
+                char header[96];
+                int length = std::snprintf(header, sizeof(header), "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n", width_, height_, frameRate_);
+                this->writeAll(reinterpret_cast<const uint8_t*>(header), static_cast<size_t>(length));
+            }
+
+            while(true)
+            {
+                size_t index = 0;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    frameReady_.wait(lock, [&]{ return count_ > 0 || stop_; });
+                    if(count_ == 0) return;
+                    index = head_;
+                }
+
+                // Слот принадлежит потоку записи до освобождения - преобразование идет без блокировки
+                if(error_.load() == 0){
+                    this->encode(slots_[index], encoded);
+                    if(this->writeAll(encoded.data(), encoded.size())) writtenCount_.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    head_ = (head_ + 1) % slots_.size();
+                    count_--;
+                }
+                slotFree_.notify_all();
+            }
+        }
+
+    public:
+        /**
+         * Конструктор (запись в открытый дескриптор)
+         * @param fd Дескриптор файла или канала (например fileno(popen("ffmpeg -i - ...", "w")))
+         * @param width Ширина кадров
+         * @param height Высота кадров
+         * @param format Формат потока
+         * @param queueCapacity Размер очереди кадров (не меньше 1)
+         * @param overflow Поведение при заполненной очереди
+         * @param frameRate Кадров в секунду (для заголовка Y4M)
+         * @param ownsFd Закрыть дескриптор при разрушении
+         */
+        FrameWriter(int fd, unsigned width, unsigned height,
+                    FrameFormat format = FrameFormat::eY4M,
+                    unsigned queueCapacity = 8,
+                    FrameOverflow overflow = FrameOverflow::eDrop,
+                    unsigned frameRate = 30,
+                    bool ownsFd = false):
+                fd_(fd),
+                ownsFd_(ownsFd),
+                format_(format),
+                overflow_(overflow),
+                frameRate_(std::max(frameRate, 1u)),
+                width_(width),
+                height_(height),
+                slots_(std::max(queueCapacity, 1u), std::vector<T>(static_cast<size_t>(width) * height))
+        {
+            writerThread_ = std::thread([this]{ writerLoop(); });
+        }
+
+        /**
+         * Конструктор (запись в файл)
+         * @param path Путь к файлу (создается или перезаписывается)
+         * @param width Ширина кадров
+         * @param height Высота кадров
+         * @param format Формат потока
+         * @param queueCapacity Размер очереди кадров (не меньше 1)
+         * @param overflow Поведение при заполненной очереди
+         * @param frameRate Кадров в секунду (для заголовка Y4M)
+         */
+        FrameWriter(const std::string& path, unsigned width, unsigned height,
+                    FrameFormat format = FrameFormat::eY4M,
+                    unsigned queueCapacity = 8,
+                    FrameOverflow overflow = FrameOverflow::eDrop,
+                    unsigned frameRate = 30):
+                FrameWriter(FrameWriter::openFile(path), width, height, format, queueCapacity, overflow, frameRate, true)
+        {}
+
+        FrameWriter(const FrameWriter&) = delete;
+        FrameWriter& operator=(const FrameWriter&) = delete;
+
+        /**
+         * Запись оставшихся кадров и остановка потока записи
+         */
+        ~FrameWriter() override
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            frameReady_.notify_one();
+            writerThread_.join();
+
+#if defined(_WIN32)
+            if(ownsFd_) _close(fd_);
+#else
+            if(ownsFd_) ::close(fd_);
+#endif
+        }
+
+        /**
+         * Открыть файл для записи
+         * @param path Путь к файлу
+         * @return Дескриптор
+         */
+        static int openFile(const std::string& path)
+        {
+#if defined(_WIN32)
+            int fd = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, 0644);
+#else
+            int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+            if(fd < 0) throw std::system_error(errno, std::generic_category(), "Unable to open frame output file: " + path);
+            return fd;
+        }
+
+        /**
+         * Поставить кадр в очередь записи
+         * @details Кадр другого размера не записывается (считается отброшенным)
+         * @param frame Буфер кадра
+         */
+        void present(const Buffer& frame) override
+        {
+            if(frame.getWidth() != width_ || frame.getHeight() != height_){
+                droppedCount_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            size_t index = 0;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                if(count_ == slots_.size()){
+                    if(overflow_ == FrameOverflow::eDrop){
+                        droppedCount_.fetch_add(1, std::memory_order_relaxed);
+                        return;
+                    }
+                    slotFree_.wait(lock, [&]{ return count_ < slots_.size(); });
+                }
+                index = (head_ + count_) % slots_.size();
+            }
+
+            // Свободный слот принадлежит выводу до постановки в очередь - копирование идет без блокировки
+            frame.copyToLinear(slots_[index].data(), width_);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                count_++;
+            }
+            frameReady_.notify_one();
+        }
+
+        /**
+         * Дождаться записи всех кадров из очереди
+         */
+        void flush()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            slotFree_.wait(lock, [&]{ return count_ == 0; });
+        }
+
+        /**
+         * Может ли запись продолжаться (не было ли ошибки записи)
+         * @return Да или нет
+         */
+        [[nodiscard]] bool isOpen() const override
+        {
+            return error_.load() == 0;
+        }
+
+        /**
+         * Получить кол-во записанных кадров
+         * @return Кол-во кадров
+         */
+        [[nodiscard]] uint64_t getWrittenCount() const
+        {
+            return writtenCount_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Получить кол-во отброшенных кадров
+         * @return Кол-во кадров
+         */
+        [[nodiscard]] uint64_t getDroppedCount() const
+        {
+            return droppedCount_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Получить код ошибки записи
+         * @return Код ошибки (errno), 0 - ошибок нет
+         */
+        [[nodiscard]] int getError() const
+        {
+            return error_.load();
+        }
+    };
+}
@@ -1,9 +1,18 @@
 #pragma once
 
 #include "ImageBuffer.hpp"
+#include "Coverage.hpp"
+
+#include <ThreadPool.hpp>
 
 #include <cmath>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
 #include <functional>
+#include <limits>
+#include <type_traits>
+#include <vector>
 
 namespace gfx
 {
@@ -12,6 +21,41 @@ namespace gfx
     constexpr std::uint_fast8_t SAFE_CHECK_KEY_POINTS  {1u << 0u};
     constexpr std::uint_fast8_t SAFE_CHECK_ALL_POINTS  {1u << 1u};
 
+    /**
+     * Уровень проверки на выход за пределы буфера, известный на этапе компиляции
+     * @tparam SAFE_CHECKS Комбинация флагов SAFE_CHECK_*
+     */
+    template<std::uint_fast8_t SAFE_CHECKS>
+    using SafeCheckLevel = std::integral_constant<std::uint_fast8_t, SAFE_CHECKS>;
+
+    /**
+     * Вызвать функцию с уровнем проверки, переведенным из времени исполнения на этап компиляции
+     * @details Используется примитивами с флагом проверки времени исполнения: ветвление выполняется один раз на вызов
+     * примитива, а циклы по точкам специализируются под конкретный уровень
+     * @tparam FUNC Тип обобщенной функции (принимает SafeCheckLevel<...>)
+     * @param safeChecks Комбинация флагов SAFE_CHECK_*
+     * @param fn Функция
+     */
+    template<typename FUNC>
+    void DispatchSafeChecks(std::uint_fast8_t safeChecks, FUNC&& fn)
+    {
+        switch(safeChecks & (SAFE_CHECK_KEY_POINTS | SAFE_CHECK_ALL_POINTS))
+        {
+            case SAFE_CHECK_KEY_POINTS:
+                fn(SafeCheckLevel<SAFE_CHECK_KEY_POINTS>());
+                break;
+            case SAFE_CHECK_ALL_POINTS:
+                fn(SafeCheckLevel<SAFE_CHECK_ALL_POINTS>());
+                break;
+            case SAFE_CHECK_KEY_POINTS | SAFE_CHECK_ALL_POINTS:
+                fn(SafeCheckLevel<SAFE_CHECK_KEY_POINTS | SAFE_CHECK_ALL_POINTS>());
+                break;
+            default:
+                fn(SafeCheckLevel<SAFE_CHECK_DISABLE>());
+                break;
+        }
+    }
+
     /**
      * Точка на плокскости
      * @tparam T ип компонентов 2D-точки
@@ -35,28 +79,48 @@ namespace gfx
     };
 
     /**
-     * Задать конкретной точке конкретный цвет
-     * @tparam T Тип пикселей в буфере изображения
+     * Задать конкретной точке конкретный цвет (уровень проверки задан на этапе компиляции)
+     * @details Без проверки (SAFE_CHECK_DISABLE) точка обязана лежать в буфере. Тайл точки разрешается при первой записи
+     * на любом уровне проверки (без отложенной очистки resolvePoint сводится к одной загрузке счетчика ожидающих тайлов)
+     * @tparam SAFE_CHECKS Уровень проверки (любой флаг, кроме SAFE_CHECK_DISABLE - проверять попадание точки в буфер)
+     * @tparam BUFFER Тип буфера изображения (ImageBuffer или ImageBufferView)
      * @param imageBuffer Указатель на объект буфера изображения
      * @param x Координаты по X
      * @param y Координаты по Y
      * @param color Цвет
-     * @param safeChecks Осуществлять проверку на выход за пределы
      */
-    template<typename T>
-    void SetPint(ImageBuffer<T>* imageBuffer, int x, int y, const T& color, bool safeChecks = true)
+    template<std::uint_fast8_t SAFE_CHECKS, typename BUFFER>
+    void SetPint(BUFFER* imageBuffer, int x, int y, const typename BUFFER::ValueType& color)
     {
-        if(safeChecks){
+        if(SAFE_CHECKS != SAFE_CHECK_DISABLE){
             if(!imageBuffer->isPointIn(x,y)) return;
         }
 
+        imageBuffer->resolvePoint(x, y);
         (*imageBuffer)[y][x] = color;
     }
 
+    /**
+     * Задать конкретной точке конкретный цвет
+     * @details См. SetPint<SAFE_CHECKS>
+     * @tparam BUFFER Тип буфера изображения (ImageBuffer или ImageBufferView)
+     * @param imageBuffer Указатель на объект буфера изображения
+     * @param x Координаты по X
+     * @param y Координаты по Y
+     * @param color Цвет
+     * @param safeChecks Осуществлять проверку на выход за пределы
+     */
+    template<typename BUFFER>
+    void SetPint(BUFFER* imageBuffer, int x, int y, const typename BUFFER::ValueType& color, bool safeChecks = true)
+    {
+        if(safeChecks) SetPint<SAFE_CHECK_ALL_POINTS>(imageBuffer, x, y, color);
+        else SetPint<SAFE_CHECK_DISABLE>(imageBuffer, x, y, color);
+    }
+
     /**
      * Задать конкретной точке конкретный цвет (учитывая глубину точки)
-     * @tparam T0 Тип пикселей в буфере изображения
-     * @tparam T1 Тип пикселей в буфере глубины
+     * @tparam COLOR_BUFFER Тип буфера изображения (ImageBuffer или ImageBufferView)
+     * @tparam DEPTH_BUFFER Тип буфера глубины (ImageBuffer или ImageBufferView)
      * @param imageBuffer Указатель на объект буфера изображения
      * @param depthBuffer Указатель на объект буфера глубины
      * @param x Координаты по X
@@ -65,13 +129,13 @@ namespace gfx
      * @param depth Глубина
      * @param safeChecks Осуществлять проверку на выход за пределы
      */
-    template<typename T0, typename T1>
-    void SetPoint(ImageBuffer<T0>* imageBuffer,
-                  ImageBuffer<T1>* depthBuffer,
+    template<typename COLOR_BUFFER, typename DEPTH_BUFFER>
+    void SetPoint(COLOR_BUFFER* imageBuffer,
+                  DEPTH_BUFFER* depthBuffer,
                   int x,
                   int y,
-                  const T0& color,
-                  const T1 depth,
+                  const typename COLOR_BUFFER::ValueType& color,
+                  const typename DEPTH_BUFFER::ValueType depth,
                   bool safeChecks = true)
     {
         if(safeChecks){
@@ -79,15 +143,357 @@ namespace gfx
             if(!depthBuffer->isPointIn(x,y)) return;
         }
 
-        if(depth < (*depthBuffer)[y][x]){
+        imageBuffer->resolvePoint(x, y);
+        depthBuffer->resolvePoint(x, y);
+
+        const DEPTH_BUFFER& depthSource = *depthBuffer;
+        if(depth < depthSource[y][x]){
             (*imageBuffer)[y][x] = color;
-            (*depth)[y][x] = depth;
+            (*depthBuffer)[y][x] = depth;
+        }
+    }
+
+    /// Предел модуля координат концов отсекаемой линии (вычисления отсечения остаются в пределах 64 бит)
+    constexpr int kLineCoordLimit = 1 << 30;
+
+    /**
+     * Ограничить прямоугольник отсечения границами буфера
+     * @tparam BUFFER Тип буфера изображения (ImageBuffer или ImageBufferView)
+     * @param imageBuffer Указатель на объект буфера изображения
+     * @param scissor Прямоугольник отсечения (границы включительно)
+     * @return Прямоугольник отсечения внутри буфера (пустой, если min > max)
+     */
+    template<typename BUFFER>
+    BBox2D<int> ClampScissor(const BUFFER* imageBuffer, const BBox2D<int>& scissor)
+    {
+        BBox2D<int> result;
+        result.min.x = std::max(scissor.min.x, 0);
+        result.min.y = std::max(scissor.min.y, 0);
+        result.max.x = std::min(scissor.max.x, static_cast<int>(imageBuffer->getWidth()) - 1);
+        result.max.y = std::min(scissor.max.y, static_cast<int>(imageBuffer->getHeight()) - 1);
+        return result;
+    }
+
+    /**
+     * Отсечение отрезка прямоугольником (алгоритм Лианга-Барски, в вещественных числах)
+     * @details Используется только для приведения концов очень длинных линий в пределы kLineCoordLimit
+     * @param x0 Координаты точки начала по X
+     * @param y0 Координаты точки начала по Y
+     * @param x1 Координаты точки конца по X
+     * @param y1 Координаты точки конца по Y
+     * @param clip Прямоугольник отсечения (границы включительно)
+     * @return Виден ли отрезок
+     */
+    inline bool ClipSegmentLiangBarsky(double& x0, double& y0, double& x1, double& y1, const BBox2D<double>& clip)
+    {
+        const double dx = x1 - x0;
+        const double dy = y1 - y0;
+        const double p[4] = {-dx, dx, -dy, dy};
+        const double q[4] = {x0 - clip.min.x, clip.max.x - x0, y0 - clip.min.y, clip.max.y - y0};
+
+        double tMin = 0.0;
+        double tMax = 1.0;
+
+        for(int i = 0; i < 4; i++)
+        {
+            if(p[i] == 0.0){
+                if(q[i] < 0.0) return false;
+                continue;
+            }
+
+            const double t = q[i] / p[i];
+            if(p[i] < 0.0) tMin = std::max(tMin, t);
+            else tMax = std::min(tMax, t);
+            if(tMin > tMax) return false;
+        }
+
+        x1 = x0 + tMax * dx;
+        y1 = y0 + tMax * dy;
+        x0 = x0 + tMin * dx;
+        y0 = y0 + tMin * dy;
+        return true;
+    }
+
+    /**
+     * Линия, приведенная к главной оси (для растеризации алгоритмом Брезенхэма)
+     * @details Для главной оси X точка k-го шага (k от 0 до stepMajor - 1) имеет координаты
+     * (x0 + k, y0 + dirY * floor(k * stepMinor / stepMajor)), где stepMajor = dx + 1, stepMinor = dy + 1
+     * (при главной оси Y координаты меняются местами). Поэтому диапазон шагов, попадающих в прямоугольник, и ошибка
+     * Брезенхэма в любом шаге вычисляются аналитически, без обхода точек.
+     */
+    struct LineSetup
+    {
+        /// Начало по главной оси
+        int x0;
+        /// Начало по второстепенной оси
+        int y0;
+        /// Кол-во шагов по главной оси (dx + 1)
+        int64_t stepMajor;
+        /// Приращение ошибки за шаг (dy + 1)
+        int64_t stepMinor;
+        /// Направление по второстепенной оси (-1, 0, 1)
+        int dirY;
+        /// Главная ось - Y
+        bool axisSwapped;
+
+        /**
+         * Конструктор
+         * @param ax0 Координаты точки начала по X
+         * @param ay0 Координаты точки начала по Y
+         * @param ax1 Координаты точки конца по X
+         * @param ay1 Координаты точки конца по Y
+         */
+        LineSetup(int ax0, int ay0, int ax1, int ay1)
+        {
+            axisSwapped = std::abs(static_cast<int64_t>(ax1) - ax0) < std::abs(static_cast<int64_t>(ay1) - ay0);
+            if(axisSwapped){
+                std::swap(ax0, ay0);
+                std::swap(ax1, ay1);
+            }
+
+            if(ax0 > ax1){
+                std::swap(ax0, ax1);
+                std::swap(ay0, ay1);
+            }
+
+            x0 = ax0;
+            y0 = ay0;
+            stepMajor = static_cast<int64_t>(ax1) - ax0 + 1;
+            stepMinor = std::abs(static_cast<int64_t>(ay1) - ay0) + 1;
+            dirY = (ay1 > ay0) - (ay1 < ay0);
+        }
+
+        /**
+         * Координата по второстепенной оси в шаге
+         * @param k Номер шага
+         * @return Координата
+         */
+        [[nodiscard]] int minorAt(int64_t k) const
+        {
+            return y0 + dirY * static_cast<int>((k * stepMinor) / stepMajor);
+        }
+
+        /**
+         * Найти диапазон шагов внутри прямоугольника (целочисленное отсечение Лианга-Барски по параметру шага)
+         * @details Координаты концов линии не должны превышать по модулю kLineCoordLimit
+         * @param clip Прямоугольник отсечения (границы включительно)
+         * @param first Первый шаг внутри прямоугольника
+         * @param last Последний шаг внутри прямоугольника
+         * @return Есть ли шаги внутри прямоугольника
+         */
+        bool clipSteps(const BBox2D<int>& clip, int64_t& first, int64_t& last) const
+        {
+            const int64_t majorMin = axisSwapped ? clip.min.y : clip.min.x;
+            const int64_t majorMax = axisSwapped ? clip.max.y : clip.max.x;
+            const int64_t minorMin = axisSwapped ? clip.min.x : clip.min.y;
+            const int64_t minorMax = axisSwapped ? clip.max.x : clip.max.y;
+
+            first = std::max<int64_t>(0, majorMin - x0);
+            last = std::min<int64_t>(stepMajor - 1, majorMax - x0);
+
+            // Допустимый диапазон смещения q(k) = floor(k * stepMinor / stepMajor) по второстепенной оси
+            int64_t qLo = dirY >= 0 ? minorMin - y0 : y0 - minorMax;
+            int64_t qHi = dirY >= 0 ? minorMax - y0 : y0 - minorMin;
+            if(qHi < 0 || qLo > stepMinor - 1) return false;
+
+            qHi = std::min(qHi, stepMinor - 1);
+            if(qLo > 0) first = std::max(first, (qLo * stepMajor + stepMinor - 1) / stepMinor);
+            last = std::min(last, ((qHi + 1) * stepMajor - 1) / stepMinor);
+
+            return first <= last;
+        }
+
+        /**
+         * Обход точек линии в диапазоне шагов (без проверок и ветвлений в цикле)
+         * @tparam FUNC Тип функции обработки точки (void(int x, int y))
+         * @param first Первый шаг
+         * @param last Последний шаг
+         * @param plot Функция обработки точки
+         */
+        template<typename FUNC>
+        void rasterize(int64_t first, int64_t last, FUNC&& plot) const
+        {
+            int64_t error = (first * stepMinor) % stepMajor;
+            int y = this->minorAt(first);
+            int x = x0 + static_cast<int>(first);
+            const int end = x0 + static_cast<int>(last);
+
+            if(!axisSwapped){
+                for(; x <= end; x++)
+                {
+                    plot(x, y);
+                    error += stepMinor;
+                    const bool stepY = error >= stepMajor;
+                    y += stepY ? dirY : 0;
+                    error -= stepY ? stepMajor : 0;
+                }
+            }
+            else{
+                for(; x <= end; x++)
+                {
+                    plot(y, x);
+                    error += stepMinor;
+                    const bool stepY = error >= stepMajor;
+                    y += stepY ? dirY : 0;
+                    error -= stepY ? stepMajor : 0;
+                }
+            }
+        }
+    };
+
+    /**
+     * Привести концы линии в пределы kLineCoordLimit (нужно только для очень длинных линий)
+     * @details Наклон линии может измениться не более чем на пиксель
+     * @param x0 Координаты точки начала по X
+     * @param y0 Координаты точки начала по Y
+     * @param x1 Координаты точки конца по X
+     * @param y1 Координаты точки конца по Y
+     * @return Осталась ли часть линии в пределах
+     */
+    inline bool LimitLineCoords(int& x0, int& y0, int& x1, int& y1)
+    {
+        auto outOfLimit = [](int v){ return v < -kLineCoordLimit || v > kLineCoordLimit; };
+        if(!outOfLimit(x0) && !outOfLimit(y0) && !outOfLimit(x1) && !outOfLimit(y1)) return true;
+
+        double fx0 = x0, fy0 = y0, fx1 = x1, fy1 = y1;
+        const BBox2D<double> limit = {{-kLineCoordLimit, -kLineCoordLimit}, {kLineCoordLimit, kLineCoordLimit}};
+        if(!ClipSegmentLiangBarsky(fx0, fy0, fx1, fy1, limit)) return false;
+
+        x0 = static_cast<int>(std::lround(fx0));
+        y0 = static_cast<int>(std::lround(fy0));
+        x1 = static_cast<int>(std::lround(fx1));
+        y1 = static_cast<int>(std::lround(fy1));
+        return true;
+    }
+
+    /**
+     * Обход точек линии (алгоритм Брезенхэма) с отсечением прямоугольником
+     * @details Отсечение выполняется до обхода и не меняет растеризацию (см. LineSetup): отсеченная линия состоит ровно
+     * из тех же пикселей, что и неотсеченная, поэтому соседние прямоугольники (тайлы) не дают разрывов и наложений.
+     * В самом цикле проверок нет.
+     * @tparam FUNC Тип функции обработки точки (void(int x, int y))
+     * @param x0 Координаты точки начала по X
+     * @param y0 Координаты точки начала по Y
+     * @param x1 Координаты точки конца по X
+     * @param y1 Координаты точки конца по Y
+     * @param clip Прямоугольник отсечения (границы включительно, nullptr - без отсечения)
+     * @param plot Функция обработки точки
+     */
+    template<typename FUNC>
+    void RasterizeLine(int x0, int y0, int x1, int y1, const BBox2D<int>* clip, FUNC&& plot)
+    {
+        if(clip == nullptr){
+            const LineSetup line(x0, y0, x1, y1);
+            line.rasterize(0, line.stepMajor - 1, plot);
+            return;
+        }
+
+        if(clip->min.x > clip->max.x || clip->min.y > clip->max.y) return;
+        if(!LimitLineCoords(x0, y0, x1, y1)) return;
+
+        const LineSetup line(x0, y0, x1, y1);
+        int64_t first, last;
+        if(line.clipSteps(*clip, first, last)) line.rasterize(first, last, plot);
+    }
+
+    /**
+     * Выполнить отложенную очистку тайлов, через которые проходит линия
+     * @details Вызывается один раз перед обходом точек: диапазон шагов делится на части длиной kLazyClearTileSize по
+     * главной оси, для каждой части очищается ее описывающий прямоугольник (по второстепенной оси часть смещается не
+     * больше чем на kLazyClearTileSize). Точки диапазона обязаны лежать в буфере.
+     * @tparam BUFFER Тип буфера изображения (ImageBuffer или ImageBufferView)
+     * @param imageBuffer Указатель на объект буфера изображения
+     * @param line Линия
+     * @param first Первый шаг
+     * @param last Последний шаг
+     */
+    template<typename BUFFER>
+    void ResolveLine(BUFFER* imageBuffer, const LineSetup& line, int64_t first, int64_t last)
+    {
+        if(!imageBuffer->hasPendingClear()) return;
+
+        for(int64_t k = first; k <= last;)
+        {
+            const int majorA = line.x0 + static_cast<int>(k);
+            const int64_t kEnd = std::min<int64_t>(last, k + kLazyClearTileSize - 1 - majorA % kLazyClearTileSize);
+            const int majorB = line.x0 + static_cast<int>(kEnd);
+            const int minorA = line.minorAt(k);
+            const int minorB = line.minorAt(kEnd);
+
+            if(!line.axisSwapped) imageBuffer->resolveRect(majorA, std::min(minorA, minorB), majorB, std::max(minorA, minorB));
+            else imageBuffer->resolveRect(std::min(minorA, minorB), majorA, std::max(minorA, minorB), majorB);
+
+            k = kEnd + 1;
+        }
+    }
+
+    /**
+     * Растеризация линии в буфере изображения с отсечением прямоугольником (алгоритм Брезенхэма)
+     * @details Отложенная очистка выполняется один раз для видимой части линии (см. ResolveLine), цикл по точкам -
+     * только запись в буфер
+     * @tparam BUFFER Тип буфера изображения (ImageBuffer или ImageBufferView)
+     * @param imageBuffer Указатель на объект буфера изображения
+     * @param x0 Координаты точки начала по X
+     * @param y0 Координаты точки начала по Y
+     * @param x1 Координаты точки конца по X
+     * @param y1 Координаты точки конца по Y
+     * @param clip Прямоугольник отсечения внутри буфера (границы включительно, nullptr - линия целиком лежит в буфере)
+     * @param color Цвет линии
+     */
+    template<typename BUFFER>
+    void SetLineClipped(BUFFER* imageBuffer,
+                        int x0, int y0,
+                        int x1, int y1,
+                        const BBox2D<int>* clip,
+                        const typename BUFFER::ValueType& color)
+    {
+        if(clip != nullptr){
+            if(clip->min.x > clip->max.x || clip->min.y > clip->max.y) return;
+            if(!LimitLineCoords(x0, y0, x1, y1)) return;
+        }
+
+        const LineSetup line(x0, y0, x1, y1);
+        int64_t first = 0;
+        int64_t last = line.stepMajor - 1;
+        if(clip != nullptr && !line.clipSteps(*clip, first, last)) return;
+
+        ResolveLine(imageBuffer, line, first, last);
+        line.rasterize(first, last, [&](int x, int y){ (*imageBuffer)[y][x] = color; });
+    }
+
+    /**
+     * Растеризация линии в буфере изображения (алгоритм Брезенхэма, уровень проверки задан на этапе компиляции)
+     * @details При любой проверке (SAFE_CHECK_KEY_POINTS, SAFE_CHECK_ALL_POINTS) линия отсекается границами буфера
+     * до растеризации (частично видимые линии рисуются частично, без проверки каждой точки). Без проверки
+     * (SAFE_CHECK_DISABLE) линия обязана целиком лежать в буфере.
+     * @tparam SAFE_CHECKS Уровень проверки
+     * @tparam BUFFER Тип буфера изображения (ImageBuffer или ImageBufferView)
+     * @param imageBuffer Указатель на объект буфера изображения
+     * @param x0 Координаты точки начала по X
+     * @param y0 Координаты точки начала по Y
+     * @param x1 Координаты точки конца по X
+     * @param y1 Координаты точки конца по Y
+     * @param color Цвет линии
+     */
+    template<std::uint_fast8_t SAFE_CHECKS, typename BUFFER>
+    void SetLine(BUFFER* imageBuffer,
+                 int x0, int y0,
+                 int x1, int y1,
+                 const typename BUFFER::ValueType& color)
+    {
+        if(SAFE_CHECKS != SAFE_CHECK_DISABLE){
+            const BBox2D<int> bounds = {{0, 0}, {static_cast<int>(imageBuffer->getWidth()) - 1, static_cast<int>(imageBuffer->getHeight()) - 1}};
+            SetLineClipped(imageBuffer, x0, y0, x1, y1, &bounds, color);
+        }
+        else{
+            SetLineClipped(imageBuffer, x0, y0, x1, y1, nullptr, color);
         }
     }
 
     /**
      * Растеризация линии в буфере изображения (алгоритм Брезенхэма)
-     * @tparam T Тип пикселей в буфере изображения
+     * @details См. SetLine<SAFE_CHECKS>
+     * @tparam BUFFER Тип буфера изображения (ImageBuffer или ImageBufferView)
      * @param imageBuffer Указатель на объект буфера изображения
      * @param x0 Координаты точки начала по X
      * @param y0 Координаты точки начала по Y
@@ -96,61 +502,230 @@ namespace gfx
      * @param color Цвет линии
      * @param safeChecks Осуществлять проверку на выход за пределы
      */
-    template<typename T>
-    void SetLine(ImageBuffer<T>* imageBuffer,
+    template<typename BUFFER>
+    void SetLine(BUFFER* imageBuffer,
                  int x0, int y0,
                  int x1, int y1,
-                 const T& color,
+                 const typename BUFFER::ValueType& color,
                  std::uint_fast8_t safeChecks = SAFE_CHECK_KEY_POINTS)
     {
-        if(safeChecks & SAFE_CHECK_KEY_POINTS){
-            if(!imageBuffer->isPointIn(x0,y0)) return;
-            if(!imageBuffer->isPointIn(x1,y1)) return;
-        }
+        DispatchSafeChecks(safeChecks, [&](auto level){
+            SetLine<decltype(level)::value>(imageBuffer, x0, y0, x1, y1, color);
+        });
+    }
 
-        bool axisSwapped = false;
-        if(abs(static_cast<int>(x1) - static_cast<int>(x0)) < abs(static_cast<int>(y1) - static_cast<int>(y0)))
-        {
-            axisSwapped = true;
-            std::swap(x0,y0);
-            std::swap(x1,y1);
-        }
+    /**
+     * Растеризация линии в буфере изображения с отсечением прямоугольником (алгоритм Брезенхэма)
+     * @details Рисуются только точки линии внутри прямоугольника отсечения и буфера - ровно те же, что и при
+     * растеризации без отсечения
+     * @tparam BUFFER Тип буфера изображения (ImageBuffer или ImageBufferView)
+     * @param imageBuffer Указатель на объект буфера изображения
+     * @param x0 Координаты точки начала по X
+     * @param y0 Координаты точки начала по Y
+     * @param x1 Координаты точки конца по X
+     * @param y1 Координаты точки конца по Y
+     * @param color Цвет линии
+     * @param scissor Прямоугольник отсечения (границы включительно)
+     */
+    template<typename BUFFER>
+    void SetLine(BUFFER* imageBuffer,
+                 int x0, int y0,
+                 int x1, int y1,
+                 const typename BUFFER::ValueType& color,
+                 const BBox2D<int>& scissor)
+    {
+        const BBox2D<int> clip = ClampScissor(imageBuffer, scissor);
+        SetLineClipped(imageBuffer, x0, y0, x1, y1, &clip, color);
+    }
+
+    /**
+     * Заполнить горизонтальный отрезок строки (без проверок)
+     * @tparam BUFFER Тип буфера изображения (ImageBuffer или ImageBufferView)
+     * @param imageBuffer Указатель на объект буфера изображения
+     * @param y Номер строки
+     * @param x0 Левая граница по X (включительно)
+     * @param x1 Правая граница по X (включительно)
+     * @param color Цвет
+     */
+    template<typename BUFFER>
+    void SetSpan(BUFFER* imageBuffer, int y, int x0, int x1, const typename BUFFER::ValueType& color)
+    {
+        imageBuffer->resolveRect(x0, y, x1, y);
 
-        int deltaX = abs(static_cast<int>(x1) - static_cast<int>(x0));
-        int deltaY = abs(static_cast<int>(y1) - static_cast<int>(y0));
+        auto line = (*imageBuffer)[y];
+        for(int x = x0; x <= x1; x++) line[x] = color;
+    }
 
-        if (x0 > x1){
-            std::swap(x0, x1);
-            std::swap(y0, y1);
+    /**
+     * Полуширина строки заполненного эллипса
+     * @details Пиксель (dx, dy) относительно центра принадлежит эллипсу, если его центр лежит внутри эллипса с полуосями
+     * rx + 0.5 и ry + 0.5. Для окружности (rx = ry = r) условие целочисленное: dx^2 + dy^2 <= r^2 + r.
+     * @param dy Смещение строки от центра
+     * @param rx Радиус по X
+     * @param ry Радиус по Y
+     * @return Наибольшее dx в строке (-1 - строка не пересекает эллипс)
+     */
+    inline int64_t EllipseHalfWidth(int64_t dy, int64_t rx, int64_t ry)
+    {
+        if(dy < -ry || dy > ry) return -1;
+
+        if(rx == ry){
+            const int64_t limit = rx * rx + rx - dy * dy;
+            auto dx = static_cast<int64_t>(std::sqrt(static_cast<double>(limit)));
+            while(dx * dx > limit) dx--;
+            while((dx + 1) * (dx + 1) <= limit) dx++;
+            return dx;
         }
 
-        int error = 0;
-        int deltaErr = (deltaY + 1);
+        const double a = static_cast<double>(rx) + 0.5;
+        const double t = static_cast<double>(dy) / (static_cast<double>(ry) + 0.5);
+        return static_cast<int64_t>(std::floor(a * std::sqrt(1.0 - t * t)));
+    }
+
+    /**
+     * Обход горизонтальных отрезков эллипса (заполненного или контура) с отсечением прямоугольником
+     * @details Обходятся только строки внутри прямоугольника отсечения, отрезки ограничиваются его границами - затраты
+     * пропорциональны видимой части. Контур - пиксели эллипса, у которых хотя бы один из 4 соседей вне эллипса
+     * (замкнутая линия толщиной в пиксель, совпадающая с границей заполненного эллипса).
+     * @tparam FUNC Тип функции обработки отрезка (void(int y, int x0, int x1), границы включительно)
+     * @param cx Координаты центра по X
+     * @param cy Координаты центра по Y
+     * @param rx Радиус по X
+     * @param ry Радиус по Y
+     * @param fill Заполненный эллипс (иначе - контур)
+     * @param clip Прямоугольник отсечения (границы включительно, nullptr - без отсечения)
+     * @param span Функция обработки отрезка
+     */
+    template<typename FUNC>
+    void RasterizeEllipseSpans(int cx, int cy, int rx, int ry, bool fill, const BBox2D<int>* clip, FUNC&& span)
+    {
+        if(rx < 0 || ry < 0) return;
 
-        int y = y0;
-        int dirY = y1 - y0;
+        int64_t dyFirst = -static_cast<int64_t>(ry);
+        int64_t dyLast = ry;
+        int64_t clipMinX = std::numeric_limits<int64_t>::min();
+        int64_t clipMaxX = std::numeric_limits<int64_t>::max();
 
-        if (dirY > 0) dirY = 1;
-        if (dirY < 0) dirY = -1;
+        if(clip != nullptr){
+            dyFirst = std::max<int64_t>(dyFirst, static_cast<int64_t>(clip->min.y) - cy);
+            dyLast = std::min<int64_t>(dyLast, static_cast<int64_t>(clip->max.y) - cy);
+            clipMinX = clip->min.x;
+            clipMaxX = clip->max.x;
+        }
 
-        bool check = safeChecks & SAFE_CHECK_ALL_POINTS;
+        auto emit = [&](int64_t dy, int64_t x0, int64_t x1){
+            x0 = std::max(x0, clipMinX);
+            x1 = std::min(x1, clipMaxX);
+            if(x0 <= x1) span(static_cast<int>(cy + dy), static_cast<int>(x0), static_cast<int>(x1));
+        };
 
-        for(int x = x0; x <= x1; x++)
+        for(int64_t dy = dyFirst; dy <= dyLast; dy++)
         {
-            if(!axisSwapped) SetPint(imageBuffer, x, y, color, check);
-            else SetPint(imageBuffer, y, x, color, check);
+            const int64_t half = EllipseHalfWidth(dy, rx, ry);
+
+            if(fill){
+                emit(dy, cx - half, cx + half);
+                continue;
+            }
 
-            error += deltaErr;
-            if(error >= (deltaX + 1)){
-                y += dirY;
-                error -= (deltaX + 1);
+            // Пиксели строки, над или под которыми (в соседней строке) эллипса уже нет
+            const int64_t inner = std::min(EllipseHalfWidth(dy - 1, rx, ry), EllipseHalfWidth(dy + 1, rx, ry));
+            const int64_t start = std::min(inner + 1, half);
+
+            if(start <= 0){
+                emit(dy, cx - half, cx + half);
+            }
+            else{
+                emit(dy, cx - half, cx - start);
+                emit(dy, cx + start, cx + half);
             }
         }
     }
 
     /**
-     * Растеризация окружности в буфере изображения (алгоритм Брезенхэма)
-     * @tparam T Тип пикселей в буфере изображения
+     * Растеризация эллипса в буфере изображения (уровень проверки задан на этапе компиляции)
+     * @details Эллипс рисуется горизонтальными отрезками, которые заполняются целыми строками. При любой проверке строки
+     * и отрезки отсекаются границами буфера (частично видимый эллипс рисуется частично). Без проверки
+     * (SAFE_CHECK_DISABLE) эллипс обязан целиком лежать в буфере.
+     * @tparam SAFE_CHECKS Уровень проверки
+     * @tparam BUFFER Тип буфера изображения (ImageBuffer или ImageBufferView)
+     * @param imageBuffer Указатель на объект буфера изображения
+     * @param cx Координаты центра по X
+     * @param cy Координаты центра по Y
+     * @param rx Радиус по X
+     * @param ry Радиус по Y
+     * @param color Цвет
+     * @param fill Нужно ли закрашивать эллипс
+     */
+    template<std::uint_fast8_t SAFE_CHECKS, typename BUFFER>
+    void SetEllipse(BUFFER* imageBuffer,
+                    int cx, int cy,
+                    int rx, int ry,
+                    const typename BUFFER::ValueType& color,
+                    bool fill = false)
+    {
+        auto span = [&](int y, int x0, int x1){ SetSpan(imageBuffer, y, x0, x1, color); };
+
+        if(SAFE_CHECKS == SAFE_CHECK_DISABLE){
+            RasterizeEllipseSpans(cx, cy, rx, ry, fill, nullptr, span);
+            return;
+        }
+
+        const BBox2D<int> bounds = {{0, 0}, {static_cast<int>(imageBuffer->getWidth()) - 1, static_cast<int>(imageBuffer->getHeight()) - 1}};
+        RasterizeEllipseSpans(cx, cy, rx, ry, fill, &bounds, span);
+    }
+
+    /**
+     * Растеризация эллипса в буфере изображения
+     * @details См. SetEllipse<SAFE_CHECKS>
+     * @tparam BUFFER Тип буфера изображения (ImageBuffer или ImageBufferView)
+     * @param imageBuffer Указатель на объект буфера изображения
+     * @param cx Координаты центра по X
+     * @param cy Координаты центра по Y
+     * @param rx Радиус по X
+     * @param ry Радиус по Y
+     * @param color Цвет
+     * @param fill Нужно ли закрашивать эллипс
+     * @param safeChecks Осуществлять проверку на выход за пределы
+     */
+    template<typename BUFFER>
+    void SetEllipse(BUFFER* imageBuffer,
+                    int cx, int cy,
+                    int rx, int ry,
+                    const typename BUFFER::ValueType& color,
+                    bool fill = false,
+                    std::uint_fast8_t safeChecks = SAFE_CHECK_KEY_POINTS)
+    {
+        DispatchSafeChecks(safeChecks, [&](auto level){
+            SetEllipse<decltype(level)::value>(imageBuffer, cx, cy, rx, ry, color, fill);
+        });
+    }
+
+    /**
+     * Растеризация окружности в буфере изображения (уровень проверки задан на этапе компиляции)
+     * @details Окружность - контур круга с радиусом r (см. SetEllipse): рисуется горизонтальными отрезками, при любой
+     * проверке обходятся только строки внутри буфера, а отрезки отсекаются его границами - затраты пропорциональны
+     * видимой части. Без проверки (SAFE_CHECK_DISABLE) окружность обязана целиком лежать в буфере.
+     * @tparam SAFE_CHECKS Уровень проверки
+     * @tparam BUFFER Тип буфера изображения (ImageBuffer или ImageBufferView)
+     * @param imageBuffer Указатель на объект буфера изображения
+     * @param x1 Координаты точки центра окружности по X
+     * @param y1 Координаты точки центра окружности по Y
+     * @param r Радицс
+     * @param color Цвет окружности
+     */
+    template<std::uint_fast8_t SAFE_CHECKS, typename BUFFER>
+    void SetCircle(BUFFER* imageBuffer,
+                   int x1, int y1, int r,
+                   const typename BUFFER::ValueType& color)
+    {
+        SetEllipse<SAFE_CHECKS>(imageBuffer, x1, y1, r, r, color, false);
+    }
+
+    /**
+     * Растеризация окружности в буфере изображения
+     * @details См. SetCircle<SAFE_CHECKS>
+     * @tparam BUFFER Тип буфера изображения (ImageBuffer или ImageBufferView)
      * @param imageBuffer Указатель на объект буфера изображения
      * @param x1 Координаты точки центра окружности по X
      * @param y1 Координаты точки центра окружности по Y
@@ -158,52 +733,82 @@ namespace gfx
      * @param color Цвет окружности
      * @param safeChecks Осуществлять проверку на выход за пределы
      */
-    template<typename T>
-    void SetCircle(ImageBuffer<T>* imageBuffer,
+    template<typename BUFFER>
+    void SetCircle(BUFFER* imageBuffer,
                    int x1, int y1, int r,
-                   const T& color,
+                   const typename BUFFER::ValueType& color,
                    std::uint_fast8_t safeChecks = SAFE_CHECK_KEY_POINTS)
     {
-        if(safeChecks & SAFE_CHECK_KEY_POINTS){
-            if(!imageBuffer->isPointIn(x1+r,y1)) return;
-            if(!imageBuffer->isPointIn(x1-r,y1)) return;
-            if(!imageBuffer->isPointIn(x1,y1+r)) return;
-            if(!imageBuffer->isPointIn(x1,y1-r)) return;
-        }
-
-        int x = 0;
-        int y = r;
-        int delta = 1 - 2 * r;
-        int error = 0;
-
-        bool check = safeChecks & SAFE_CHECK_ALL_POINTS;
-
-        while (y >= 0)
-        {
-            SetPint(imageBuffer, x1 + x, y1 + y, color, check);
-            SetPint(imageBuffer, x1 + x, y1 - y, color, check);
-            SetPint(imageBuffer, x1 - x, y1 + y, color, check);
-            SetPint(imageBuffer, x1 - x, y1 - y, color, check);
-
-            error = 2 * (delta + y) - 1;
+        DispatchSafeChecks(safeChecks, [&](auto level){
+            SetCircle<decltype(level)::value>(imageBuffer, x1, y1, r, color);
+        });
+    }
 
-            if((delta < 0) && (error <= 0)){
-                delta += 2 * ++x + 1;
-                continue;
-            }
+    /**
+     * Растеризация заполненного круга в буфере изображения (уровень проверки задан на этапе компиляции)
+     * @details Круг рисуется горизонтальными отрезками с отсечением границами буфера (см. SetEllipse<SAFE_CHECKS>)
+     * @tparam SAFE_CHECKS Уровень проверки
+     * @tparam BUFFER Тип буфера изображения (ImageBuffer или ImageBufferView)
+     * @param imageBuffer Указатель на объект буфера изображения
+     * @param cx Координаты центра по X
+     * @param cy Координаты центра по Y
+     * @param r Радиус
+     * @param color Цвет
+     */
+    template<std::uint_fast8_t SAFE_CHECKS, typename BUFFER>
+    void SetFilledCircle(BUFFER* imageBuffer,
+                         int cx, int cy, int r,
+                         const typename BUFFER::ValueType& color)
+    {
+        SetEllipse<SAFE_CHECKS>(imageBuffer, cx, cy, r, r, color, true);
+    }
 
-            if ((delta > 0) && (error > 0)){
-                delta -= 2 * --y + 1;
-                continue;
-            }
+    /**
+     * Растеризация заполненного круга в буфере изображения
+     * @details См. SetEllipse<SAFE_CHECKS>
+     * @tparam BUFFER Тип буфера изображения (ImageBuffer или ImageBufferView)
+     * @param imageBuffer Указатель на объект буфера изображения
+     * @param cx Координаты центра по X
+     * @param cy Координаты центра по Y
+     * @param r Радиус
+     * @param color Цвет
+     * @param safeChecks Осуществлять проверку на выход за пределы
+     */
+    template<typename BUFFER>
+    void SetFilledCircle(BUFFER* imageBuffer,
+                         int cx, int cy, int r,
+                         const typename BUFFER::ValueType& color,
+                         std::uint_fast8_t safeChecks = SAFE_CHECK_KEY_POINTS)
+    {
+        SetEllipse(imageBuffer, cx, cy, r, r, color, true, safeChecks);
+    }
 
-            delta += 2 * (++x - y--);
-        }
+    /**
+     * Растеризация контуров прямоугольника в буфере изображения (уровень проверки задан на этапе компиляции)
+     * @tparam SAFE_CHECKS Уровень проверки
+     * @tparam BUFFER Тип буфера изображения (ImageBuffer или ImageBufferView)
+     * @param imageBuffer Указатель на объект буфера изображения
+     * @param x0 Координаты первой точки по X
+     * @param y0 Координаты первой точки по Y
+     * @param x1 Координаты второй точки конца по X
+     * @param y1 Координаты первой точки конца по Y
+     * @param color Цвет линий
+     */
+    template<std::uint_fast8_t SAFE_CHECKS, typename BUFFER>
+    void SetBox(BUFFER* imageBuffer,
+                int x0, int y0,
+                int x1, int y1,
+                const typename BUFFER::ValueType& color)
+    {
+        SetLine<SAFE_CHECKS>(imageBuffer,x0,y0,x1,y0,color);
+        SetLine<SAFE_CHECKS>(imageBuffer,x1,y0,x1,y1,color);
+        SetLine<SAFE_CHECKS>(imageBuffer,x1,y1,x0,y1,color);
+        SetLine<SAFE_CHECKS>(imageBuffer,x0,y1,x0,y0,color);
     }
 
     /**
      * Растеризация контуров прямоугольника в буфере изображения
-     * @tparam T Тип пикселей в буфере изображения
+     * @tparam BUFFER Тип буфера изображения (ImageBuffer или ImageBufferView)
      * @param imageBuffer Указатель на объект буфера изображения
      * @param x0 Координаты первой точки по X
      * @param y0 Координаты первой точки по Y
@@ -212,22 +817,41 @@ namespace gfx
      * @param color Цвет линий
      * @param safeChecks Осуществлять проверку на выход за пределы
      */
-    template<typename T>
-    void SetBox(ImageBuffer<T>* imageBuffer,
+    template<typename BUFFER>
+    void SetBox(BUFFER* imageBuffer,
                 int x0, int y0,
                 int x1, int y1,
-                const T& color,
+                const typename BUFFER::ValueType& color,
                 std::uint_fast8_t safeChecks = SAFE_CHECK_KEY_POINTS)
     {
-        SetLine(imageBuffer,x0,y0,x1,y0,color,safeChecks);
-        SetLine(imageBuffer,x1,y0,x1,y1,color,safeChecks);
-        SetLine(imageBuffer,x1,y1,x0,y1,color,safeChecks);
-        SetLine(imageBuffer,x0,y1,x0,y0,color,safeChecks);
+        DispatchSafeChecks(safeChecks, [&](auto level){
+            SetBox<decltype(level)::value>(imageBuffer, x0, y0, x1, y1, color);
+        });
+    }
+
+    /**
+     * Растеризация контуров прямоугольника в буфере изображения (уровень проверки задан на этапе компиляции)
+     * @tparam SAFE_CHECKS Уровень проверки
+     * @tparam BUFFER Тип буфера изображения (ImageBuffer или ImageBufferView)
+     * @param imageBuffer Указатель на объект буфера изображения
+     * @param x0 Координаты верхней левой точки по X
+     * @param y0 Координаты верхней левой точки по X
+     * @param width Ширина
+     * @param height Высота
+     * @param color Цвет линий
+     */
+    template<std::uint_fast8_t SAFE_CHECKS, typename BUFFER>
+    void SetRectangle(BUFFER* imageBuffer,
+                      int x0, int y0,
+                      int width, int height,
+                      const typename BUFFER::ValueType& color)
+    {
+        SetBox<SAFE_CHECKS>(imageBuffer,x0,y0,x0+width,y0+height,color);
     }
 
     /**
      * Растеризация контуров прямоугольника в буфере изображения
-     * @tparam T Тип пикселей в буфере изображения
+     * @tparam BUFFER Тип буфера изображения (ImageBuffer или ImageBufferView)
      * @param imageBuffer Указатель на объект буфера изображения
      * @param x0 Координаты верхней левой точки по X
      * @param y0 Координаты верхней левой точки по X
@@ -236,45 +860,215 @@ namespace gfx
      * @param color Цвет линий
      * @param safeChecks Осуществлять проверку на выход за пределы
      */
-    template<typename T>
-    void SetRectangle(ImageBuffer<T>* imageBuffer,
+    template<typename BUFFER>
+    void SetRectangle(BUFFER* imageBuffer,
                       int x0, int y0,
                       int width, int height,
-                      const T& color,
+                      const typename BUFFER::ValueType& color,
                       std::uint_fast8_t safeChecks = SAFE_CHECK_KEY_POINTS)
     {
         SetBox(imageBuffer,x0,y0,x0+width,y0+height,color,safeChecks);
     }
 
+    /**
+     * Заливка связной области строками (алгоритм заполнения отрезками с явным стеком)
+     * @details Область - 4-связное множество точек, для которых inside возвращает true. Отрезок строки сначала
+     * просматривается целиком, затем заливается одним вызовом set; в стек попадают только диапазоны соседних строк,
+     * которые еще не просмотрены. Глубина рекурсии не зависит от размера области, каждая точка проверяется не более
+     * нескольких раз. После вызова set для отрезка inside для его точек обязана возвращать false.
+     * @tparam INSIDE Тип функции проверки точки (bool(int x, int y), координаты всегда в пределах размеров)
+     * @tparam SET Тип функции заливки отрезка (void(int y, int x0, int x1), границы включительно)
+     * @param x0 Точка начала заливки по X
+     * @param y0 Точка начала заливки по Y
+     * @param width Ширина области поиска
+     * @param height Высота области поиска
+     * @param inside Функция проверки точки
+     * @param set Функция заливки отрезка
+     */
+    template<typename INSIDE, typename SET>
+    void RasterizeFloodFill(int x0, int y0, int width, int height, INSIDE&& inside, SET&& set)
+    {
+        if(x0 < 0 || y0 < 0 || x0 >= width || y0 >= height || !inside(x0, y0)) return;
+
+        // Диапазон строки [x1, x2], который нужно просмотреть, и направление, в котором он был найден
+        struct Seed { int x1; int x2; int y; int dy; };
+
+        std::vector<Seed> stack;
+        auto push = [&](int x1, int x2, int y, int dy){
+            if(y >= 0 && y < height) stack.push_back({x1, x2, y, dy});
+        };
+
+        push(x0, x0, y0, 1);
+        push(x0, x0, y0 - 1, -1);
+
+        while(!stack.empty())
+        {
+            const Seed seed = stack.back();
+            stack.pop_back();
+
+            int x1 = seed.x1;
+            const int x2 = seed.x2;
+            const int y = seed.y;
+            const int dy = seed.dy;
+            int x = x1;
+
+            // Продолжение отрезка влево от начала диапазона
+            if(inside(x, y)){
+                while(x > 0 && inside(x - 1, y)) x--;
+                if(x < x1){
+                    set(y, x, x1 - 1);
+                    push(x, x1 - 1, y - dy, -dy);
+                }
+            }
+
+            while(x1 <= x2)
+            {
+                const int runStart = x1;
+                while(x1 < width && inside(x1, y)) x1++;
+                if(x1 > runStart) set(y, runStart, x1 - 1);
+
+                if(x1 > x) push(x, x1 - 1, y + dy, dy);
+                if(x1 - 1 > x2) push(x2 + 1, x1 - 1, y - dy, -dy);
+
+                x1++;
+                while(x1 < x2 && !inside(x1, y)) x1++;
+                x = x1;
+            }
+        }
+    }
+
     /**
      * Заливка фрагмента буфера ограниченного контукром отличным от сцвета фона
-     * @tparam T Тип пикселей в буфере изображения
+     * @details Заливка отрезками строк с явным стеком (см. RasterizeFloodFill) - размер области не ограничен глубиной
+     * стека вызовов. Если новый цвет сам равен цвету фона (по isColorEqual), залитые точки отмечаются в отдельной маске.
+     * @tparam BUFFER Тип буфера изображения (ImageBuffer или ImageBufferView)
+     * @tparam EQUAL Тип функции сравнения цветов (bool(const ValueType& pixel, const ValueType& background))
      * @param imageBuffer Указатель на объект буфера изображения
      * @param x0 Точка начала заливки по X
      * @param y0 Точка начала заливки по Y
      * @param backgroundColor Фоновый цвет
      * @param newColor Новый цвет
-     * @param isColorEqual Функция обратного вызова для сравнения цветов
+     * @param isColorEqual Функция сравнения цветов
      */
-    template<typename T>
-    void Fill(ImageBuffer<T>* imageBuffer,
+    template<typename BUFFER, typename EQUAL = std::equal_to<typename BUFFER::ValueType>>
+    void Fill(BUFFER* imageBuffer,
               int x0, int y0,
-              const T& backgroundColor,
-              const T& newColor,
-              std::function<bool(const T&, const T&)> isColorEqual)
+              const typename BUFFER::ValueType& backgroundColor,
+              const typename BUFFER::ValueType& newColor,
+              EQUAL isColorEqual = EQUAL())
     {
-        if(x0 < 0 || x0 > (imageBuffer->getWidth()-1) || y0 < 0 || y0 > (imageBuffer->getHeight()-1))
-            return;
+        const int width = static_cast<int>(imageBuffer->getWidth());
+        const int height = static_cast<int>(imageBuffer->getHeight());
+        if(!imageBuffer->isPointIn(x0, y0)) return;
+
+        // Отложенная очистка выполняется построчно при первом обращении к строке
+        std::vector<uint8_t> resolvedRows(static_cast<size_t>(height), 0);
+        auto resolveRow = [&](int y){
+            if(!resolvedRows[y]){
+                imageBuffer->resolveRect(0, y, width - 1, y);
+                resolvedRows[y] = 1;
+            }
+        };
+
+        // Чтение - через константный доступ (разреженный буфер не выделяет тайлы, которые только просматриваются)
+        const BUFFER& source = *imageBuffer;
+        auto pixel = [&](int x, int y){
+            resolveRow(y);
+            return source[y][x];
+        };
 
-        if(!isColorEqual((*imageBuffer)[y0][x0],backgroundColor))
+        auto set = [&](int y, int xa, int xb){
+            resolveRow(y);
+            auto line = (*imageBuffer)[y];
+            for(int x = xa; x <= xb; x++) line[x] = newColor;
+        };
+
+        if(!isColorEqual(newColor, backgroundColor)){
+            RasterizeFloodFill(x0, y0, width, height, [&](int x, int y){
+                return isColorEqual(pixel(x, y), backgroundColor);
+            }, set);
             return;
+        }
+
+        // Залитые точки остаются "фоном" - отмечать их отдельно
+        std::vector<uint8_t> filled(static_cast<size_t>(width) * height, 0);
+        RasterizeFloodFill(x0, y0, width, height, [&](int x, int y){
+            return !filled[static_cast<size_t>(y) * width + x] && isColorEqual(pixel(x, y), backgroundColor);
+        }, [&](int y, int xa, int xb){
+            std::fill_n(filled.begin() + static_cast<ptrdiff_t>(static_cast<size_t>(y) * width + xa), xb - xa + 1, 1);
+            set(y, xa, xb);
+        });
+    }
+
+    /**
+     * Заливка фрагмента буфера ограниченного контукром отличным от сцвета фона (для больших областей, с пулом потоков)
+     * @details Выполняется в три прохода: сравнение цветов всех точек буфера (параллельно по полосам строк) в маску,
+     * заливка отрезками по маске (последовательно, без обращения к пикселям) и запись нового цвета в отмеченные
+     * точки (параллельно). Выгодна, когда область занимает значительную часть буфера или сравнение цветов дорогое.
+     * Функция сравнения вызывается одновременно из нескольких потоков и должна быть потокобезопасной.
+     * @tparam BUFFER Тип буфера изображения (ImageBuffer или ImageBufferView)
+     * @tparam EQUAL Тип функции сравнения цветов (bool(const ValueType& pixel, const ValueType& background))
+     * @param imageBuffer Указатель на объект буфера изображения
+     * @param x0 Точка начала заливки по X
+     * @param y0 Точка начала заливки по Y
+     * @param backgroundColor Фоновый цвет
+     * @param newColor Новый цвет
+     * @param isColorEqual Функция сравнения цветов
+     * @param pThreadPool Указатель на пул потоков
+     */
+    template<typename BUFFER, typename EQUAL>
+    void Fill(BUFFER* imageBuffer,
+              int x0, int y0,
+              const typename BUFFER::ValueType& backgroundColor,
+              const typename BUFFER::ValueType& newColor,
+              EQUAL isColorEqual,
+              tools::ThreadPool* pThreadPool)
+    {
+        const int width = static_cast<int>(imageBuffer->getWidth());
+        const int height = static_cast<int>(imageBuffer->getHeight());
+        if(!imageBuffer->isPointIn(x0, y0)) return;
 
-        (*imageBuffer)[y0][x0] = newColor;
+        // Полосы строк выровнены по kLazyClearTileSize - потоки не выполняют отложенную очистку одних и тех же тайлов
+        const int bandHeight = kLazyClearTileSize;
+        const auto bandCount = static_cast<size_t>((height + bandHeight - 1) / bandHeight);
 
-        Fill(imageBuffer,x0+1,y0,backgroundColor,newColor,isColorEqual);
-        Fill(imageBuffer,x0-1,y0,backgroundColor,newColor,isColorEqual);
-        Fill(imageBuffer,x0,y0+1,backgroundColor,newColor,isColorEqual);
-        Fill(imageBuffer,x0,y0-1,backgroundColor,newColor,isColorEqual);
+        // Маска: 0 - не фон, 1 - фон, 2 - залито
+        std::vector<uint8_t> mask(static_cast<size_t>(width) * height);
+        // Чтение - через константный доступ (разреженный буфер не выделяет тайлы, которые только просматриваются)
+        const BUFFER& source = *imageBuffer;
+
+        pThreadPool->parallelFor(bandCount, [&](size_t band){
+            const int yBegin = static_cast<int>(band) * bandHeight;
+            const int yEnd = std::min(yBegin + bandHeight, height);
+            imageBuffer->resolveRect(0, yBegin, width - 1, yEnd - 1);
+
+            for(int y = yBegin; y < yEnd; y++)
+            {
+                auto line = source[y];
+                uint8_t* maskLine = mask.data() + static_cast<size_t>(y) * width;
+                for(int x = 0; x < width; x++) maskLine[x] = isColorEqual(line[x], backgroundColor) ? 1 : 0;
+            }
+        });
+
+        RasterizeFloodFill(x0, y0, width, height, [&](int x, int y){
+            return mask[static_cast<size_t>(y) * width + x] == 1;
+        }, [&](int y, int xa, int xb){
+            std::fill_n(mask.begin() + static_cast<ptrdiff_t>(static_cast<size_t>(y) * width + xa), xb - xa + 1, 2);
+        });
+
+        pThreadPool->parallelFor(bandCount, [&](size_t band){
+            const int yBegin = static_cast<int>(band) * bandHeight;
+            const int yEnd = std::min(yBegin + bandHeight, height);
+
+            for(int y = yBegin; y < yEnd; y++)
+            {
+                auto line = (*imageBuffer)[y];
+                const uint8_t* maskLine = mask.data() + static_cast<size_t>(y) * width;
+                for(int x = 0; x < width; x++){
+                    if(maskLine[x] == 2) line[x] = newColor;
+                }
+            }
+        });
     }
 
     /**
@@ -320,8 +1114,9 @@ namespace gfx
     }
 
     /**
-     * Растеризация треугольника в буфере изображения
-     * @tparam T Тип пикселей в буфере изображения
+     * Растеризация треугольника в буфере изображения (уровень проверки задан на этапе компиляции)
+     * @tparam SAFE_CHECKS Проверка точек на выход за пределы буфера
+     * @tparam BUFFER Тип буфера изображения (ImageBuffer или ImageBufferView)
      * @param imageBuffer Буфер изображения
      * @param x0 Координаты первой точки по X
      * @param y0 Координаты первой точки по y
@@ -331,45 +1126,117 @@ namespace gfx
      * @param y2 Координаты третьей точки по y
      * @param color Цвет контукров и заливки
      * @param fill Нужно ли закрашивать треугольник
-     * @param safeChecks Проверка точек на выход за пределы буфера
      */
-    template <typename T>
-    void SetTriangle(ImageBuffer<T>* imageBuffer,
+    template<std::uint_fast8_t SAFE_CHECKS, typename BUFFER>
+    void SetTriangle(BUFFER* imageBuffer,
             int x0, int y0,
             int x1, int y1,
             int x2, int y2,
-            T color,
-            bool fill = true,
-            std::uint_fast8_t safeChecks = SAFE_CHECK_ALL_POINTS)
+            typename BUFFER::ValueType color,
+            bool fill = true)
     {
         // Не рисовать если не прошло грубую проверку (если она включена)
-        if(safeChecks & SAFE_CHECK_KEY_POINTS){
+        if(SAFE_CHECKS & SAFE_CHECK_KEY_POINTS){
             if(!imageBuffer->isPointIn(x0,y0)) return;
             if(!imageBuffer->isPointIn(x1,y1)) return;
             if(!imageBuffer->isPointIn(x2,y2)) return;
         }
 
         // Написовать линии
-        SetLine(imageBuffer,x0,y0,x1,y1,color,safeChecks);
-        SetLine(imageBuffer,x1,y1,x2,y2,color,safeChecks);
-        SetLine(imageBuffer,x2,y2,x0,y0,color,safeChecks);
+        SetLine<SAFE_CHECKS>(imageBuffer,x0,y0,x1,y1,color);
+        SetLine<SAFE_CHECKS>(imageBuffer,x1,y1,x2,y2,color);
+        SetLine<SAFE_CHECKS>(imageBuffer,x2,y2,x0,y0,color);
 
         // Если не надо закрашивать - завершаем
         if(!fill) return;
 
-        // Получить описывающий прямоугольник
-        auto bbox = FindBoundingBox2D<int>({{x0,y0},{x1,y1},{x2,y2}});
+        // Удвоенная ориентированная площадь (положительна для обхода по часовой стрелке, ось Y направлена вниз)
+        int64_t area = static_cast<int64_t>(x1 - x0) * (y2 - y0) - static_cast<int64_t>(x2 - x0) * (y1 - y0);
+        if(area == 0) return;
+
+        // Привести треугольник к обходу по часовой стрелке
+        if(area < 0){
+            std::swap(x1, x2);
+            std::swap(y1, y2);
+        }
+
+        // Описывающий прямоугольник, ограниченный размерами буфера (проверка каждой точки не нужна)
+        int minX = std::max(std::min(x0, std::min(x1, x2)), 0);
+        int minY = std::max(std::min(y0, std::min(y1, y2)), 0);
+        int maxX = std::min(std::max(x0, std::max(x1, x2)), static_cast<int>(imageBuffer->getWidth()) - 1);
+        int maxY = std::min(std::max(y0, std::max(y1, y2)), static_cast<int>(imageBuffer->getHeight()) - 1);
+        if(minX > maxX || minY > maxY) return;
+
+        // Уравнения граней E(p) = dx * (p.y - from.y) - dy * (p.x - from.x) в виде E(x,y) = a*x + b*y + c
+        const int fromX[3] = {x0, x1, x2};
+        const int fromY[3] = {y0, y1, y2};
+        const int toX[3] = {x1, x2, x0};
+        const int toY[3] = {y1, y2, y0};
+        EdgeEquation edges[3];
 
-        // Пройтись по точкам прямугольника, и если точни принадлежат треугольнику - закрасить их
-        for(int y = bbox.min.y; y < bbox.max.y; y++)
+        for(int e = 0; e < 3; e++)
         {
-            for(int x = bbox.min.x; x < bbox.max.x; x++)
+            int64_t dx = toX[e] - fromX[e];
+            int64_t dy = toY[e] - fromY[e];
+
+            // Правило верхней-левой грани: точки на верхних и левых гранях принадлежат треугольнику,
+            // для остальных граней значение уравнения смещается на единицу (проверка становится строгой)
+            bool topLeft = (dy < 0) || (dy == 0 && dx > 0);
+
+            edges[e].a = -dy;
+            edges[e].b = dx;
+            edges[e].c = dy * fromX[e] - dx * fromY[e] - (topLeft ? 0 : 1);
+        }
+
+        // Обход блоками 8x8: полностью покрытые блоки закрашиваются целыми строками, частично покрытые - по маске
+        RasterizeCoverageBlocks(edges, minX, minY, maxX, maxY, [&](int bx, int by, uint64_t mask)
+        {
+            imageBuffer->resolveRect(bx, by, bx + kCoverageBlockSize - 1, by + kCoverageBlockSize - 1);
+
+            for(int row = 0; row < kCoverageBlockSize; row++)
             {
-                if(IsPointInTriangle<int>({x,y},{x0,y0},{x1,y1},{x2,y2}))
-                {
-                    SetPint(imageBuffer, x, y, color, safeChecks & SAFE_CHECK_ALL_POINTS);
+                auto bits = static_cast<uint32_t>(mask >> static_cast<unsigned>(row * kCoverageBlockSize)) & 0xFFu;
+                if(bits == 0) continue;
+
+                auto line = (*imageBuffer)[by + row];
+
+                if(bits == 0xFFu){
+                    for(int col = 0; col < kCoverageBlockSize; col++) line[bx + col] = color;
+                    continue;
+                }
+
+                for(int col = 0; col < kCoverageBlockSize; col++){
+                    if(bits & (1u << static_cast<unsigned>(col))) line[bx + col] = color;
                 }
             }
-        }
+        });
+    }
+
+    /**
+     * Растеризация треугольника в буфере изображения
+     * @tparam BUFFER Тип буфера изображения (ImageBuffer или ImageBufferView)
+     * @param imageBuffer Буфер изображения
+     * @param x0 Координаты первой точки по X
+     * @param y0 Координаты первой точки по y
+     * @param x1 Координаты второй точки по X
+     * @param y1 Координаты второй точки по Y
+     * @param x2 Координаты третьей точки по X
+     * @param y2 Координаты третьей точки по y
+     * @param color Цвет контукров и заливки
+     * @param fill Нужно ли закрашивать треугольник
+     * @param safeChecks Проверка точек на выход за пределы буфера
+     */
+    template<typename BUFFER>
+    void SetTriangle(BUFFER* imageBuffer,
+            int x0, int y0,
+            int x1, int y1,
+            int x2, int y2,
+            typename BUFFER::ValueType color,
+            bool fill = true,
+            std::uint_fast8_t safeChecks = SAFE_CHECK_ALL_POINTS)
+    {
+        DispatchSafeChecks(safeChecks, [&](auto level){
+            SetTriangle<decltype(level)::value>(imageBuffer, x0, y0, x1, y1, x2, y2, color, fill);
+        });
     }
 }
\ No newline at end of file
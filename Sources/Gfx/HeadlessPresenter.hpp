@@ -0,0 +1,174 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include <string>
+#include <ostream>
+#include <iomanip>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <cstdio>
+#include <cstdint>
+
+#include "Presenter.hpp"
+#include "ImageIO.hpp"
+
+namespace gfx
+{
+    /**
+     * Статистика времени кадров
+     */
+    struct FrameStats
+    {
+        /// Кол-во кадров (интервалов между выводами на один меньше)
+        uint64_t frameCount = 0;
+        /// Время от первого до последнего вывода (мс)
+        double totalMs = 0.0;
+        /// Минимальный интервал между кадрами (мс)
+        double minMs = 0.0;
+        /// Средний интервал между кадрами (мс)
+        double averageMs = 0.0;
+        /// Максимальный интервал между кадрами (мс)
+        double maxMs = 0.0;
+        /// 99-й перцентиль интервала между кадрами (мс)
+        double p99Ms = 0.0;
+        /// Кадров в секунду (по среднему интервалу)
+        double fps = 0.0;
+    };
+
+    /**
+     * Вывод кадров без дисплея (для серверов рендеринга и замеров производительности)
+     * @details Ничего не показывает, а запоминает время каждого вывода. Интервалы между выводами - время кадра с учетом
+     * ожидания в цепочке буферов. Опционально сохраняет каждый dumpInterval-й кадр в файл PPM (P6)
+     * "<dumpPrefix>NNNNNN.ppm". Статистику следует читать после окончания вывода (например после SwapChain::waitIdle).
+     * @tparam T Тип пикселей (для сохранения кадров требуется специализация PixelTraits<T>)
+     * @tparam LAYOUT Расположение пикселей в буфере кадра
+     * @tparam STORAGE Хранилище пикселей буфера кадра
+     */
+    template<typename T, typename LAYOUT = LinearLayout, typename STORAGE = HeapStorage>
+    class HeadlessPresenter : public Presenter<T, LAYOUT, STORAGE>
+    {
+    public:
+        using typename Presenter<T, LAYOUT, STORAGE>::Buffer;
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        /// Префикс пути сохраняемых кадров
+        std::string dumpPrefix_;
+        /// Интервал сохранения кадров (0 - не сохранять)
+        unsigned dumpInterval_;
+
+        /// Время первого вывода
+        Clock::time_point firstPresent_;
+        /// Время предыдущего вывода
+        Clock::time_point lastPresent_;
+        /// Интервалы между выводами (мс)
+        std::vector<double> frameTimes_;
+        /// Кол-во выведенных кадров
+        uint64_t frameCount_ = 0;
+
+        /**
+         * Сохранить кадр в файл PPM
+         * @details Запись через WriteImage (строки кодируются прямо из буфера кадра). Ошибка записи не прерывает
+         * вывод - кадр просто не сохраняется
+         * @param frame Буфер кадра
+         * @param index Номер кадра
+         */
+        void dump(const Buffer& frame, uint64_t index)
+        {
+            char suffix[32];
+            std::snprintf(suffix, sizeof(suffix), "%06llu.ppm", static_cast<unsigned long long>(index));
+
+            try{
+                WriteImage(dumpPrefix_ + suffix, frame, ImageFormat::ePPM);
+            }
+            catch(const std::exception&){}
+        }
+
+    public:
+        /**
+         * Конструктор
+         * @param dumpPrefix Префикс пути сохраняемых кадров (например "frames/frame_")
+         * @param dumpInterval Сохранять каждый N-й кадр (0 - не сохранять)
+         */
+        explicit HeadlessPresenter(std::string dumpPrefix = "", unsigned dumpInterval = 0):
+                dumpPrefix_(std::move(dumpPrefix)),
+                dumpInterval_(dumpInterval)
+        {}
+
+        /**
+         * Вывести кадр (запомнить время и, если нужно, сохранить кадр)
+         * @param frame Буфер кадра
+         */
+        void present(const Buffer& frame) override
+        {
+            auto now = Clock::now();
+
+            if(frameCount_ == 0) firstPresent_ = now;
+            else frameTimes_.push_back(std::chrono::duration<double, std::milli>(now - lastPresent_).count());
+            lastPresent_ = now;
+
+            if(dumpInterval_ != 0 && frameCount_ % dumpInterval_ == 0) this->dump(frame, frameCount_);
+            frameCount_++;
+        }
+
+        /**
+         * Получить кол-во выведенных кадров
+         * @return Кол-во кадров
+         */
+        [[nodiscard]] uint64_t getFrameCount() const
+        {
+            return frameCount_;
+        }
+
+        /**
+         * Получить интервалы между выводами кадров
+         * @return Интервалы в миллисекундах
+         */
+        [[nodiscard]] const std::vector<double>& getFrameTimes() const
+        {
+            return frameTimes_;
+        }
+
+        /**
+         * Получить статистику времени кадров
+         * @return Статистика
+         */
+        [[nodiscard]] FrameStats getStats() const
+        {
+            FrameStats stats;
+            stats.frameCount = frameCount_;
+            if(frameTimes_.empty()) return stats;
+
+            std::vector<double> sorted(frameTimes_);
+            std::sort(sorted.begin(), sorted.end());
+
+            stats.totalMs = std::chrono::duration<double, std::milli>(lastPresent_ - firstPresent_).count();
+            stats.minMs = sorted.front();
+            stats.maxMs = sorted.back();
+            stats.averageMs = std::accumulate(sorted.begin(), sorted.end(), 0.0) / static_cast<double>(sorted.size());
+            stats.p99Ms = sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)];
+            stats.fps = stats.averageMs > 0.0 ? 1000.0 / stats.averageMs : 0.0;
+            return stats;
+        }
+
+        /**
+         * Вывести статистику времени кадров в поток
+         * @param stream Поток вывода
+         */
+        void report(std::ostream& stream) const
+        {
+            FrameStats stats = this->getStats();
+            stream << std::fixed << std::setprecision(3)
+                   << "frames: " << stats.frameCount
+                   << "  total: " << stats.totalMs << " ms"
+                   << "  avg: " << stats.averageMs << " ms"
+                   << "  min: " << stats.minMs << " ms"
+                   << "  max: " << stats.maxMs << " ms"
+                   << "  p99: " << stats.p99Ms << " ms"
+                   << "  fps: " << std::setprecision(1) << stats.fps << std::endl;
+        }
+    };
+}
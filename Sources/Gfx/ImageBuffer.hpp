@@ -1,25 +1,145 @@
 #pragma once
 #include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <ThreadPool.hpp>
+
+#include "ImageLayout.hpp"
+#include "ImageStorage.hpp"
+#include "ImageBufferView.hpp"
+#include "MemoryFill.hpp"
 
 namespace gfx
 {
+    /// Размер стороны тайла отложенной очистки (в пикселях)
+    constexpr int kLazyClearTileSize = 32;
+
     /**
      * Буфер данных двумерного изображения
+     * @details Расположение пикселей в памяти задается политикой LAYOUT. При линейном расположении (по умолчанию) строки
+     * начинаются с адресов выровненных по kImageRowAlignment байт, поэтому длина строки в памяти (pitch) может быть
+     * больше ширины изображения. При тайловых расположениях строка не непрерывна - operator[] возвращает прокси-объект,
+     * а для вывода изображения используется copyToLinear. Доступ к строкам - только через operator[] или с учетом getPitch().
+     *
+     * Отложенная очистка (clearDeferred) не записывает пиксели, а помечает тайлы kLazyClearTileSize x kLazyClearTileSize
+     * как очищенные. Тайл заполняется значением очистки при первом обращении через resolveRect/resolvePoint (их вызывают
+     * примитивы и растеризаторы перед чтением и записью), либо при resolve. Прямой доступ через operator[] и getData
+     * флаги не учитывает - перед ним нужно вызвать resolve (или resolveRect для нужной области).
+     *
+     * Память под пиксели выделяется хранилищем STORAGE: в куче (HeapStorage) или в отображаемом в память файле
+     * (MappedFileStorage) - для изображений, не помещающихся в ОЗУ.
      * @tparam T Тип или класс описывающий цвет одного элемента (текселя) текстуры
+     * @tparam LAYOUT Политика расположения пикселей (LinearLayout, TiledLayout, MortonLayout)
+     * @tparam STORAGE Хранилище пикселей (HeapStorage, MappedFileStorage)
      */
-    template<typename T>
+    template<typename T, typename LAYOUT = LinearLayout, typename STORAGE = HeapStorage>
     class ImageBuffer
     {
+        static_assert(std::is_trivially_copyable<T>::value, "ImageBuffer element type must be trivially copyable");
+
+    public:
+        /// Тип пикселей
+        using ValueType = T;
+
     private:
         unsigned width_ = 0;
         unsigned height_ = 0;
+        unsigned pitch_ = 0;
         T* data_;
 
+        /// Хранилище пикселей
+        STORAGE storage_;
+
+        /// Флаги тайлов ожидающих отложенной очистки (1 - тайл еще не заполнен значением очистки)
+        std::vector<uint8_t> clearTiles_;
+        /// Значение отложенной очистки
+        T clearValue_{};
+        /// Кол-во тайлов ожидающих отложенной очистки (0 - отложенной очистки нет, флаги тайлов не проверяются)
+        std::atomic<size_t> pendingClearTiles_{0};
+
+        /**
+         * Кол-во тайлов отложенной очистки по горизонтали
+         * @return Кол-во тайлов
+         */
+        [[nodiscard]] int getClearTilesX() const
+        {
+            return static_cast<int>((this->width_ + kLazyClearTileSize - 1) / kLazyClearTileSize);
+        }
+
+        /**
+         * Кол-во тайлов отложенной очистки по вертикали
+         * @return Кол-во тайлов
+         */
+        [[nodiscard]] int getClearTilesY() const
+        {
+            return static_cast<int>((this->height_ + kLazyClearTileSize - 1) / kLazyClearTileSize);
+        }
+
+        /**
+         * Заполнить тайл значением отложенной очистки
+         * @param tx Номер тайла по X
+         * @param ty Номер тайла по Y
+         */
+        void fillClearTile(int tx, int ty)
+        {
+            int x0 = tx * kLazyClearTileSize;
+            int y0 = ty * kLazyClearTileSize;
+            int x1 = std::min(x0 + kLazyClearTileSize, static_cast<int>(this->width_));
+            int y1 = std::min(y0 + kLazyClearTileSize, static_cast<int>(this->height_));
+
+            for(int y = y0; y < y1; y++){
+                auto line = LAYOUT::GetRow(this->data_, this->pitch_, y);
+                for(int x = x0; x < x1; x++) line[x] = clearValue_;
+            }
+        }
+
+        /**
+         * Кол-во элементов в памяти (с учетом выравнивания строк и дополнения до целых тайлов)
+         * @return Кол-во элементов
+         */
+        [[nodiscard]] size_t getStorageCount() const
+        {
+            return static_cast<size_t>(this->pitch_) * LAYOUT::PaddedHeight(this->height_);
+        }
+
+        /**
+         * Выделить память под буфер текущих размеров
+         */
+        void allocate()
+        {
+            this->pitch_ = this->width_ > 0 && this->height_ > 0 ? LAYOUT::template Pitch<T>(this->width_) : 0;
+            size_t count = this->getStorageCount();
+            this->data_ = count > 0 ? static_cast<T*>(this->storage_.allocate(count * sizeof(T))) : nullptr;
+        }
+
+        /**
+         * Освободить память буфера
+         */
+        void release()
+        {
+            if(this->data_) this->storage_.release(this->data_, this->getStorageCount() * sizeof(T));
+            this->data_ = nullptr;
+            this->width_ = 0;
+            this->height_ = 0;
+            this->pitch_ = 0;
+            this->clearTiles_.clear();
+            this->pendingClearTiles_.store(0, std::memory_order_relaxed);
+        }
+
     public:
         /**
          * Конструктор по умолчанию (инициализация пустого буфера)
          */
-        ImageBuffer(): width_(0), height_(0), data_(nullptr){};
+        ImageBuffer(): width_(0), height_(0), pitch_(0), data_(nullptr){};
 
         /**
          * Конструктор
@@ -28,25 +148,67 @@ namespace gfx
          * @param clear Значение для очистки
          */
         ImageBuffer(const unsigned width, const unsigned height, const T& clear):
+                ImageBuffer(width, height, clear, STORAGE())
+        {}
+
+        /**
+         * Конструктор с заданным хранилищем
+         * @param width Ширина изображения
+         * @param height Высота изображения
+         * @param clear Значение для очистки
+         * @param storage Хранилище пикселей (например MappedFileStorage с путем к файлу)
+         */
+        ImageBuffer(const unsigned width, const unsigned height, const T& clear, STORAGE storage):
                 width_(width),
                 height_(height),
-                data_((width * height) > 0 ? new T[width * height] : nullptr)
+                pitch_(0),
+                data_(nullptr),
+                storage_(std::move(storage))
         {
+            this->allocate();
+
             if(data_ != nullptr){
-                std::fill_n(this->data_, this->width_ * this->height_, clear);
+                std::uninitialized_fill_n(this->data_, this->getStorageCount(), clear);
             }
         }
 
+        /**
+         * Конструктор с заданным хранилищем, без очистки
+         * @details Содержимое хранилища сохраняется (например открытие ранее созданного файла изображения)
+         * @param width Ширина изображения
+         * @param height Высота изображения
+         * @param storage Хранилище пикселей
+         */
+        ImageBuffer(const unsigned width, const unsigned height, STORAGE storage):
+                width_(width),
+                height_(height),
+                pitch_(0),
+                data_(nullptr),
+                storage_(std::move(storage))
+        {
+            this->allocate();
+        }
+
         /**
          * Конструктор копирования
          * Вызывается при инициализации объекта другим объектом (присвоение во веремя создания - этот же случай)
          * @param other Копируемый объекь
          */
-        ImageBuffer(const ImageBuffer& other): ImageBuffer(other.width_, other.height_)
+        ImageBuffer(const ImageBuffer& other):
+                width_(other.width_),
+                height_(other.height_),
+                pitch_(0),
+                data_(nullptr),
+                storage_(other.storage_),
+                clearTiles_(other.clearTiles_),
+                clearValue_(other.clearValue_),
+                pendingClearTiles_(other.pendingClearTiles_.load(std::memory_order_acquire))
         {
-            if (other.data_)
+            this->allocate();
+
+            if (other.data_ && this->data_)
             {
-                memcpy(this->data_, other.data_, other.width_ * other.height_ * sizeof(T));
+                memcpy(this->data_, other.data_, this->getStorageCount() * sizeof(T));
             }
         }
 
@@ -61,6 +223,11 @@ namespace gfx
             std::swap(data_,other.data_);
             std::swap(width_,other.width_);
             std::swap(height_,other.height_);
+            std::swap(pitch_,other.pitch_);
+            std::swap(storage_,other.storage_);
+            std::swap(clearTiles_,other.clearTiles_);
+            std::swap(clearValue_,other.clearValue_);
+            pendingClearTiles_.store(other.pendingClearTiles_.exchange(0, std::memory_order_acq_rel), std::memory_order_relaxed);
         }
 
         /**
@@ -75,21 +242,8 @@ namespace gfx
             if(this == &other)
                 return *this;
 
-            // Очистить ресурс текущего объекта
-            if(data_) delete[] data_;
-            data_ = nullptr;
-            width_ = 0;
-            height_ = 0;
-
-            // Установить размеры
-            this->width_ = other.width_;
-            this->height_ = other.height_;
-
-            // Если предпологается что буфер не пуст - выделить память и скопировать в нее данные
-            if(width_ * height_ > 0){
-                this->data_ = new T[other.width_ * other.height_];
-                memcpy(this->data_, other.data_, other.width_ * other.height_ * sizeof(T));
-            }
+            // Скопировать данные (память переиспользуется, если размеры совпадают)
+            this->copyFrom(other, nullptr);
 
             // Вернуть текущий объект (ссылку)
             return *this;
@@ -107,28 +261,121 @@ namespace gfx
             if (&other == this) return *this;
 
             // Очистить ресурс текущего объекта
-            if(data_) delete[] data_;
-            data_ = nullptr;
-            width_ = 0;
-            height_ = 0;
+            this->release();
 
             // Омеенять ресурсы объектов
             std::swap(data_,other.data_);
             std::swap(width_,other.width_);
             std::swap(height_,other.height_);
+            std::swap(pitch_,other.pitch_);
+            std::swap(storage_,other.storage_);
+            std::swap(clearTiles_,other.clearTiles_);
+            std::swap(clearValue_,other.clearValue_);
+            pendingClearTiles_.store(other.pendingClearTiles_.exchange(0, std::memory_order_acq_rel), std::memory_order_relaxed);
 
             // Вернуть текущий объект (ссылку)
             return *this;
         }
 
+        /**
+         * Копирование содержимого другого буфера
+         * @details Если размеры совпадают, используется уже выделенная память (без освобождения и повторного выделения).
+         * Буферы больше kStreamFillThreshold копируются частями в потоках пула (если он задан).
+         * @param other Копируемый буфер
+         * @param pThreadPool Указатель на пул потоков (nullptr - копирование в вызывающем потоке)
+         */
+        void copyFrom(const ImageBuffer& other, tools::ThreadPool* pThreadPool)
+        {
+            if(this == &other) return;
+
+            if(this->width_ != other.width_ || this->height_ != other.height_)
+            {
+                this->release();
+                this->width_ = other.width_;
+                this->height_ = other.height_;
+                this->allocate();
+            }
+
+            if(this->data_ && other.data_)
+            {
+                const size_t size = this->getSize();
+                auto* dst = reinterpret_cast<unsigned char*>(this->data_);
+                auto* src = reinterpret_cast<const unsigned char*>(other.data_);
+                const size_t threads = pThreadPool != nullptr ? pThreadPool->getThreadCount() : 1;
+
+                if(size < kStreamFillThreshold || threads == 1){
+                    memcpy(dst, src, size);
+                }
+                else{
+                    // Части кратны размеру кеш-линии, чтобы потоки не писали в одни и те же линии
+                    size_t chunk = (size + threads - 1) / threads;
+                    chunk = ((chunk + kImageRowAlignment - 1) / kImageRowAlignment) * kImageRowAlignment;
+                    pThreadPool->parallelFor((size + chunk - 1) / chunk, [&](size_t part){
+                        size_t begin = part * chunk;
+                        memcpy(dst + begin, src + begin, std::min(chunk, size - begin));
+                    });
+                }
+            }
+
+            // Скопировать состояние отложенной очистки
+            this->clearTiles_ = other.clearTiles_;
+            this->clearValue_ = other.clearValue_;
+            this->pendingClearTiles_.store(other.pendingClearTiles_.load(std::memory_order_acquire), std::memory_order_relaxed);
+        }
+
+        /**
+         * Изменить размеры буфера
+         * @details Содержимое не сохраняется - буфер очищается значением clearValue. Если размеры не изменились,
+         * память не перевыделяется. При смене разрешения с PooledStorage память берется из пула.
+         * @param width Новая ширина
+         * @param height Новая высота
+         * @param clearValue Значение для очистки
+         */
+        void resize(unsigned width, unsigned height, const T& clearValue)
+        {
+            this->resize(width, height);
+            this->clear(clearValue);
+        }
+
+        /**
+         * Изменить размеры буфера без очистки
+         * @details Содержимое не определено (например для последующей полной перезаписи при чтении изображения из файла),
+         * отложенная очистка отменяется
+         * @param width Новая ширина
+         * @param height Новая высота
+         */
+        void resize(unsigned width, unsigned height)
+        {
+            if(this->width_ != width || this->height_ != height)
+            {
+                this->release();
+                this->width_ = width;
+                this->height_ = height;
+                this->allocate();
+            }
+
+            this->clearTiles_.clear();
+            this->pendingClearTiles_.store(0, std::memory_order_relaxed);
+        }
+
         /**
          * Оператор для работы с буфером как с двумерным массивом
          * @param y Номер ряда
-         * @return Указатель на часть массива данных
+         * @return Указатель на часть массива данных (для нелинейных расположений - прокси-объект строки)
          */
-        T* operator[](int y)
+        typename LAYOUT::template Row<T> operator[](int y)
         {
-            return this->data_ + this->width_ * y;
+            return LAYOUT::GetRow(this->data_, this->pitch_, y);
+        }
+
+        /**
+         * Оператор для работы с буфером как с двумерным массивом (только чтение)
+         * @param y Номер ряда
+         * @return Указатель на часть массива данных (для нелинейных расположений - прокси-объект строки)
+         */
+        typename LAYOUT::template Row<const T> operator[](int y) const
+        {
+            return LAYOUT::GetRow(static_cast<const T*>(this->data_), this->pitch_, y);
         }
 
         /**
@@ -136,36 +383,210 @@ namespace gfx
          */
         ~ImageBuffer()
         {
-            delete[] data_;
+            this->release();
         }
 
         /**
-         * Получить размер в байтах
+         * Получить размер в байтах (с учетом выравнивания строк)
          * @return
          */
-        [[nodiscard]] unsigned int getSize() const {
-            return this->width_ * this->height_ * sizeof(T);
+        [[nodiscard]] size_t getSize() const {
+            return this->getStorageCount() * sizeof(T);
+        }
+
+        /**
+         * Сохранить данные в хранилище (для файлового хранилища - записать измененные страницы в файл)
+         * @details Предварительно выполняется отложенная очистка, чтобы в хранилище оказалось готовое изображение
+         */
+        void flush()
+        {
+            if(this->data_ == nullptr) return;
+            this->resolve();
+            this->storage_.flush(this->data_, this->getSize());
+        }
+
+        /**
+         * Получить хранилище пикселей
+         * @return Ссылка на хранилище
+         */
+        const STORAGE& getStorage() const
+        {
+            return this->storage_;
         }
 
         /**
          * Очистка буфера
+         * @details Буферы больше kStreamFillThreshold очищаются потоковой записью в обход кеша (см. StreamFill)
          * @param clearValue
          */
         void clear(const T& clearValue){
-            if((this->width_ * this->height_) > 0 && this->data_){
-                std::fill_n(this->data_, this->width_ * this->height_, clearValue);
-                //memset(this->data_,0,this->width_ * this->height_ * sizeof(T));
+            this->clear(clearValue, nullptr);
+        }
+
+        /**
+         * Очистка буфера с разделением работы между потоками пула
+         * @details Буферы больше kStreamFillThreshold делятся на части (по числу потоков пула), каждая часть
+         * очищается потоковой записью в обход кеша. Небольшие буферы очищаются в вызывающем потоке обычным образом.
+         * @param clearValue Значение для очистки
+         * @param pThreadPool Указатель на пул потоков (nullptr - очистка в вызывающем потоке)
+         */
+        void clear(const T& clearValue, tools::ThreadPool* pThreadPool){
+            if(this->data_ == nullptr) return;
+            this->pendingClearTiles_.store(0, std::memory_order_relaxed);
+
+            const size_t count = this->getStorageCount();
+            if(count * sizeof(T) < kStreamFillThreshold){
+                std::fill_n(this->data_, count, clearValue);
+                return;
+            }
+
+            const size_t threads = pThreadPool != nullptr ? pThreadPool->getThreadCount() : 1;
+            if(threads == 1){
+                StreamFill(this->data_, count, clearValue);
+                return;
             }
+
+            // Части кратны kStreamFillBlockSize элементам, поэтому их границы выровнены так же как начало буфера
+            size_t chunk = (count + threads - 1) / threads;
+            chunk = ((chunk + kStreamFillBlockSize - 1) / kStreamFillBlockSize) * kStreamFillBlockSize;
+            const size_t parts = (count + chunk - 1) / chunk;
+
+            T* data = this->data_;
+            pThreadPool->parallelFor(parts, [&](size_t part){
+                size_t begin = part * chunk;
+                StreamFill(data + begin, std::min(chunk, count - begin), clearValue);
+            });
         }
 
         /**
-         * Получить данные
+         * Отложенная очистка буфера
+         * @details Пиксели не записываются - все тайлы помечаются как очищенные значением clearValue и заполняются
+         * при первом обращении (см. resolveRect). Области кадра, которых не коснулась отрисовка, не записываются вовсе
+         * (до resolve), а copyToLinear выводит их сразу значением очистки.
+         * @param clearValue Значение для очистки
+         */
+        void clearDeferred(const T& clearValue){
+            if(this->data_ == nullptr) return;
+
+            this->clearValue_ = clearValue;
+            const size_t tileCount = static_cast<size_t>(this->getClearTilesX()) * static_cast<size_t>(this->getClearTilesY());
+            this->clearTiles_.assign(tileCount, 1);
+            this->pendingClearTiles_.store(tileCount, std::memory_order_release);
+        }
+
+        /**
+         * Есть ли тайлы, ожидающие отложенной очистки
+         * @details Когда заполнен последний тайл, флаг сбрасывается сам (без вызова resolve)
+         * @return Да или нет
+         */
+        [[nodiscard]] bool hasPendingClear() const
+        {
+            return this->pendingClearTiles_.load(std::memory_order_acquire) != 0;
+        }
+
+        /**
+         * Выполнить отложенную очистку тайлов, пересекающих прямоугольную область
+         * @details Вызывается перед чтением или записью пикселей области. Вызовы из разных потоков допустимы, если их
+         * области не пересекают одни и те же тайлы (например области выровнены по kLazyClearTileSize).
+         * Координаты за пределами буфера отбрасываются.
+         * @param minX Левая граница области (включительно)
+         * @param minY Верхняя граница области (включительно)
+         * @param maxX Правая граница области (включительно)
+         * @param maxY Нижняя граница области (включительно)
+         */
+        void resolveRect(int minX, int minY, int maxX, int maxY)
+        {
+            if(!this->hasPendingClear()) return;
+
+            minX = std::max(minX, 0);
+            minY = std::max(minY, 0);
+            maxX = std::min(maxX, static_cast<int>(this->width_) - 1);
+            maxY = std::min(maxY, static_cast<int>(this->height_) - 1);
+            if(minX > maxX || minY > maxY) return;
+
+            const int tilesX = this->getClearTilesX();
+            size_t resolved = 0;
+            for(int ty = minY / kLazyClearTileSize; ty <= maxY / kLazyClearTileSize; ty++){
+                for(int tx = minX / kLazyClearTileSize; tx <= maxX / kLazyClearTileSize; tx++){
+                    uint8_t& pending = this->clearTiles_[static_cast<size_t>(ty) * tilesX + tx];
+                    if(!pending) continue;
+                    this->fillClearTile(tx, ty);
+                    pending = 0;
+                    resolved++;
+                }
+            }
+
+            if(resolved > 0) this->pendingClearTiles_.fetch_sub(resolved, std::memory_order_acq_rel);
+        }
+
+        /**
+         * Выполнить отложенную очистку тайла, содержащего точку
+         * @param x Координаты точки по X
+         * @param y Координаты точки по Y
+         */
+        void resolvePoint(int x, int y)
+        {
+            if(this->hasPendingClear()) this->resolveRect(x, y, x, y);
+        }
+
+        /**
+         * Выполнить отложенную очистку всех оставшихся тайлов
+         * @details После вызова к буферу можно обращаться напрямую (operator[], getData)
+         */
+        void resolve()
+        {
+            this->resolveRect(0, 0, static_cast<int>(this->width_) - 1, static_cast<int>(this->height_) - 1);
+        }
+
+        /**
+         * Получить представление прямоугольной области буфера (без копирования)
+         * @details Доступно только для линейного расположения. Прямоугольник ограничивается границами буфера,
+         * отложенная очистка области выполняется заранее (представление не учитывает флаги тайлов).
+         * @param x Левая граница по X
+         * @param y Верхняя граница по Y
+         * @param width Ширина
+         * @param height Высота
+         * @return Представление области
+         */
+        ImageBufferView<T> getView(unsigned x, unsigned y, unsigned width, unsigned height)
+        {
+            static_assert(LAYOUT::kContiguousRows, "ImageBufferView requires a linear layout");
+
+            x = std::min(x, this->width_);
+            y = std::min(y, this->height_);
+            width = std::min(width, this->width_ - x);
+            height = std::min(height, this->height_ - y);
+            if(width == 0 || height == 0) return ImageBufferView<T>();
+
+            this->resolveRect(static_cast<int>(x), static_cast<int>(y), static_cast<int>(x + width) - 1, static_cast<int>(y + height) - 1);
+            return ImageBufferView<T>(this->data_ + static_cast<size_t>(this->pitch_) * y + x, width, height, this->pitch_);
+        }
+
+        /**
+         * Получить представление всего буфера (без копирования)
+         * @return Представление буфера
+         */
+        ImageBufferView<T> getView()
+        {
+            return this->getView(0, 0, this->width_, this->height_);
+        }
+
+        /**
+         * Получить данные (в порядке расположения, заданном политикой LAYOUT)
          * @return
          */
         T* getData(){
             return this->data_;
         }
 
+        /**
+         * Получить данные только для чтения (в порядке расположения, заданном политикой LAYOUT)
+         * @return
+         */
+        const T* getData() const {
+            return this->data_;
+        }
+
         /**
          * Получить ширину
          * @return
@@ -184,6 +605,46 @@ namespace gfx
             return this->height_;
         }
 
+        /**
+         * Получить длину строки в памяти (в элементах, не меньше ширины)
+         * @details Для тайловых расположений - ширина, дополненная до целого кол-ва тайлов
+         * @return
+         */
+        [[nodiscard]] unsigned int getPitch() const
+        {
+            return this->pitch_;
+        }
+
+        /**
+         * Копирование изображения в линейный массив (например для вывода на экран)
+         * @details Для тайловых расположений выполняет перевод в линейное расположение. Тайлы, ожидающие отложенной
+         * очистки, выводятся значением очистки (сам буфер не меняется).
+         * @param dst Массив назначения (не менее dstPitch * height элементов)
+         * @param dstPitch Длина строки массива назначения в элементах
+         */
+        void copyToLinear(T* dst, size_t dstPitch) const
+        {
+            if(this->data_ == nullptr) return;
+            LAYOUT::CopyToLinear(static_cast<const T*>(this->data_), this->pitch_, this->width_, this->height_, dst, dstPitch);
+
+            if(!this->hasPendingClear()) return;
+
+            // Неочищенные тайлы содержат устаревшие данные - заменить их значением очистки
+            const int tilesX = this->getClearTilesX();
+            const int tilesY = this->getClearTilesY();
+            for(int ty = 0; ty < tilesY; ty++){
+                for(int tx = 0; tx < tilesX; tx++){
+                    if(!this->clearTiles_[static_cast<size_t>(ty) * tilesX + tx]) continue;
+
+                    int x0 = tx * kLazyClearTileSize;
+                    int y0 = ty * kLazyClearTileSize;
+                    int count = std::min(kLazyClearTileSize, static_cast<int>(this->width_) - x0);
+                    int y1 = std::min(y0 + kLazyClearTileSize, static_cast<int>(this->height_));
+                    for(int y = y0; y < y1; y++) std::fill_n(dst + dstPitch * y + x0, count, this->clearValue_);
+                }
+            }
+        }
+
         /**
          * Проверка попадания точки в границы буфера кадра
          * @param x Координаты точки по X
@@ -199,5 +660,12 @@ namespace gfx
                 static_cast<unsigned>(y) <= (this->getHeight()-1) && static_cast<unsigned>(y) >= 0;
         }
     };
-}
 
+    /**
+     * Буфер изображения с памятью из пула (см. ImageMemoryPool)
+     * @tparam T Тип пикселей
+     * @tparam LAYOUT Политика расположения пикселей
+     */
+    template<typename T, typename LAYOUT = LinearLayout>
+    using PooledImageBuffer = ImageBuffer<T, LAYOUT, PooledStorage>;
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstddef>
+#include <algorithm>
+#include <type_traits>
+
+namespace gfx
+{
+    /**
+     * Невладеющее представление прямоугольной области изображения с линейным расположением пикселей
+     * @details Хранит только указатель на первый пиксель области, размеры и длину строки в памяти, поэтому создается и
+     * копируется без копирования пикселей. Позволяет рисовать в часть кадра (тайл, область вывода, область
+     * пост-обработки) теми же примитивами и растеризаторами, что и во весь буфер. Время жизни памяти, на которую
+     * ссылается представление, контролируется владельцем (например ImageBuffer).
+     * @tparam T Тип пикселей (const T - представление только для чтения)
+     */
+    template<typename T>
+    class ImageBufferView
+    {
+    public:
+        /// Тип пикселей
+        using ValueType = typename std::remove_const<T>::type;
+
+    private:
+        T* data_;
+        unsigned width_;
+        unsigned height_;
+        unsigned pitch_;
+
+    public:
+        /**
+         * Конструктор по умолчанию (пустое представление)
+         */
+        ImageBufferView(): data_(nullptr), width_(0), height_(0), pitch_(0){}
+
+        /**
+         * Конструктор
+         * @param data Указатель на первый пиксель области
+         * @param width Ширина области
+         * @param height Высота области
+         * @param pitch Длина строки в памяти (в элементах, не меньше ширины)
+         */
+        ImageBufferView(T* data, unsigned width, unsigned height, unsigned pitch):
+                data_(data),
+                width_(width),
+                height_(height),
+                pitch_(pitch)
+        {}
+
+        /**
+         * Преобразование в представление только для чтения
+         * @return Представление той же области
+         */
+        operator ImageBufferView<const T>() const
+        {
+            return ImageBufferView<const T>(data_, width_, height_, pitch_);
+        }
+
+        /**
+         * Получить представление части области
+         * @details Прямоугольник ограничивается границами текущей области
+         * @param x Левая граница по X
+         * @param y Верхняя граница по Y
+         * @param width Ширина
+         * @param height Высота
+         * @return Представление
+         */
+        [[nodiscard]] ImageBufferView getView(unsigned x, unsigned y, unsigned width, unsigned height) const
+        {
+            x = std::min(x, width_);
+            y = std::min(y, height_);
+            width = std::min(width, width_ - x);
+            height = std::min(height, height_ - y);
+
+            if(width == 0 || height == 0) return ImageBufferView();
+            return ImageBufferView(data_ + static_cast<ptrdiff_t>(pitch_) * y + x, width, height, pitch_);
+        }
+
+        /**
+         * Оператор для работы с областью как с двумерным массивом
+         * @param y Номер ряда (относительно области)
+         * @return Указатель на начало ряда области
+         */
+        T* operator[](int y) const
+        {
+            return data_ + static_cast<ptrdiff_t>(pitch_) * y;
+        }
+
+        /**
+         * Получить указатель на первый пиксель области
+         * @return
+         */
+        [[nodiscard]] T* getData() const
+        {
+            return data_;
+        }
+
+        /**
+         * Получить ширину
+         * @return
+         */
+        [[nodiscard]] unsigned int getWidth() const
+        {
+            return width_;
+        }
+
+        /**
+         * Получить высоту
+         * @return
+         */
+        [[nodiscard]] unsigned int getHeight() const
+        {
+            return height_;
+        }
+
+        /**
+         * Получить длину строки в памяти (в элементах)
+         * @return
+         */
+        [[nodiscard]] unsigned int getPitch() const
+        {
+            return pitch_;
+        }
+
+        /**
+         * Проверка попадания точки в границы области
+         * @param x Координаты точки по X
+         * @param y Координаты точки по Y
+         * @return Да или нет
+         */
+        [[nodiscard]] bool isPointIn(int x, int y) const
+        {
+            return data_ != nullptr && static_cast<unsigned>(x) < width_ && static_cast<unsigned>(y) < height_;
+        }
+
+        /**
+         * Отложенная очистка в представлении не используется (область разрешается при создании представления)
+         */
+        void resolveRect(int, int, int, int) const {}
+
+        /**
+         * Отложенная очистка в представлении не используется (область разрешается при создании представления)
+         */
+        void resolvePoint(int, int) const {}
+
+        /**
+         * Отложенная очистка в представлении не используется (область разрешается при создании представления)
+         * @return Всегда false
+         */
+        [[nodiscard]] bool hasPendingClear() const
+        {
+            return false;
+        }
+    };
+}
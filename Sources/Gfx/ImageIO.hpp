@@ -0,0 +1,1116 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "ImageBuffer.hpp"
+#include "ImageBufferView.hpp"
+#include "Pixel.hpp"
+
+namespace gfx
+{
+    /**
+     * Формат файла изображения
+     */
+    enum class ImageFormat
+    {
+        /// Определить по расширению файла или по сигнатуре данных
+        eUnknown,
+        /// Portable Pixmap (P6 - запись, P5/P6 с глубиной до 8 бит - чтение)
+        ePPM,
+        /// Truevision TGA (32 бит без сжатия - запись, 8/24/32 бит с RLE и без - чтение)
+        eTGA,
+        /// Windows Bitmap (32 бит BI_BITFIELDS - запись, 24/32 бит - чтение)
+        eBMP,
+        /// Quite OK Image (RGBA)
+        eQOI
+    };
+
+    /**
+     * Определить формат изображения по расширению файла
+     * @param path Путь к файлу
+     * @return Формат (eUnknown - расширение не распознано)
+     */
+    inline ImageFormat GetImageFormat(const std::string& path)
+    {
+        auto dot = path.find_last_of('.');
+        if(dot == std::string::npos) return ImageFormat::eUnknown;
+
+        std::string extension = path.substr(dot + 1);
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](char c){
+            return static_cast<char>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+        });
+
+        if(extension == "ppm" || extension == "pgm" || extension == "pnm") return ImageFormat::ePPM;
+        if(extension == "tga") return ImageFormat::eTGA;
+        if(extension == "bmp") return ImageFormat::eBMP;
+        if(extension == "qoi") return ImageFormat::eQOI;
+        return ImageFormat::eUnknown;
+    }
+
+    /**
+     * Определить формат изображения по сигнатуре данных
+     * @details У TGA нет сигнатуры - данные без распознанной сигнатуры считаются TGA
+     * @param data Данные файла
+     * @param size Размер данных
+     * @return Формат
+     */
+    inline ImageFormat DetectImageFormat(const uint8_t* data, size_t size)
+    {
+        if(size >= 2 && data[0] == 'P' && (data[1] == '5' || data[1] == '6')) return ImageFormat::ePPM;
+        if(size >= 2 && data[0] == 'B' && data[1] == 'M') return ImageFormat::eBMP;
+        if(size >= 4 && memcmp(data, "qoif", 4) == 0) return ImageFormat::eQOI;
+        return ImageFormat::eTGA;
+    }
+
+    namespace detail
+    {
+        /**
+         * Файл, отображенный в память только для чтения
+         */
+        class MappedInputFile
+        {
+        private:
+            const uint8_t* data_ = nullptr;
+            size_t size_ = 0;
+#if defined(_WIN32)
+            HANDLE file_ = INVALID_HANDLE_VALUE;
+            HANDLE mapping_ = nullptr;
+#endif
+
+        public:
+            /**
+             * Конструктор (открытие и отображение файла)
+             * @param path Путь к файлу
+             */
+            explicit MappedInputFile(const std::string& path)
+            {
+#if defined(_WIN32)
+                file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+                if(file_ == INVALID_HANDLE_VALUE){
+                    throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "Unable to open image file: " + path);
+                }
+
+                LARGE_INTEGER fileSize;
+                GetFileSizeEx(file_, &fileSize);
+                size_ = static_cast<size_t>(fileSize.QuadPart);
+                if(size_ == 0) return;
+
+                mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                const void* ptr = mapping_ != nullptr ? MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0) : nullptr;
+                if(ptr == nullptr){
+                    auto code = static_cast<int>(GetLastError());
+                    this->close();
+                    throw std::system_error(code, std::system_category(), "Unable to map image file: " + path);
+                }
+                data_ = static_cast<const uint8_t*>(ptr);
+#else
+                int fd = ::open(path.c_str(), O_RDONLY);
+                if(fd < 0) throw std::system_error(errno, std::generic_category(), "Unable to open image file: " + path);
+
+                struct stat info = {};
+                if(fstat(fd, &info) != 0){
+                    int code = errno;
+                    ::close(fd);
+                    throw std::system_error(code, std::generic_category(), "Unable to read image file: " + path);
+                }
+
+                size_ = static_cast<size_t>(info.st_size);
+                if(size_ == 0){
+                    ::close(fd);
+                    return;
+                }
+
+                void* ptr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                int code = errno;
+                ::close(fd);
+                if(ptr == MAP_FAILED) throw std::system_error(code, std::generic_category(), "Unable to map image file: " + path);
+
+                // Файл читается один раз от начала до конца
+                madvise(ptr, size_, MADV_SEQUENTIAL);
+                data_ = static_cast<const uint8_t*>(ptr);
+#endif
+            }
+
+            MappedInputFile(const MappedInputFile&) = delete;
+            MappedInputFile& operator=(const MappedInputFile&) = delete;
+
+            ~MappedInputFile()
+            {
+                this->close();
+            }
+
+            /**
+             * Снять отображение и закрыть файл
+             */
+            void close()
+            {
+#if defined(_WIN32)
+                if(data_ != nullptr) UnmapViewOfFile(data_);
+                if(mapping_ != nullptr) CloseHandle(mapping_);
+                if(file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+                mapping_ = nullptr;
+                file_ = INVALID_HANDLE_VALUE;
+#else
+                if(data_ != nullptr) munmap(const_cast<uint8_t*>(data_), size_);
+#endif
+                data_ = nullptr;
+                size_ = 0;
+            }
+
+            [[nodiscard]] const uint8_t* getData() const
+            {
+                return data_;
+            }
+
+            [[nodiscard]] size_t getSize() const
+            {
+                return size_;
+            }
+        };
+
+        /**
+         * Запись в файл (буферизованная)
+         */
+        class FileSink
+        {
+        private:
+            std::FILE* file_;
+            std::string path_;
+
+        public:
+            /// Размер буфера записи
+            static constexpr size_t kBufferSize = 1u << 20u;
+
+            explicit FileSink(const std::string& path): file_(std::fopen(path.c_str(), "wb")), path_(path)
+            {
+                if(file_ == nullptr) throw std::system_error(errno, std::generic_category(), "Unable to create image file: " + path);
+                std::setvbuf(file_, nullptr, _IOFBF, kBufferSize);
+            }
+
+            FileSink(const FileSink&) = delete;
+            FileSink& operator=(const FileSink&) = delete;
+
+            ~FileSink()
+            {
+                if(file_ != nullptr) std::fclose(file_);
+            }
+
+            void write(const void* data, size_t size)
+            {
+                if(size > 0 && std::fwrite(data, 1, size, file_) != size){
+                    throw std::system_error(errno, std::generic_category(), "Unable to write image file: " + path_);
+                }
+            }
+
+            /**
+             * Закрыть файл (с проверкой записи буфера)
+             */
+            void close()
+            {
+                std::FILE* file = file_;
+                file_ = nullptr;
+                if(std::fclose(file) != 0) throw std::system_error(errno, std::generic_category(), "Unable to write image file: " + path_);
+            }
+        };
+
+        /**
+         * Запись в массив байт
+         */
+        class VectorSink
+        {
+        private:
+            std::vector<uint8_t>& out_;
+
+        public:
+            explicit VectorSink(std::vector<uint8_t>& out): out_(out){}
+
+            void write(const void* data, size_t size)
+            {
+                auto* bytes = static_cast<const uint8_t*>(data);
+                out_.insert(out_.end(), bytes, bytes + size);
+            }
+        };
+
+        /**
+         * Источник строк изображения для записи (общий случай - сбор строки через operator[])
+         * @tparam BUFFER Тип буфера изображения
+         */
+        template<typename BUFFER>
+        class RowSource
+        {
+        public:
+            using ValueType = typename BUFFER::ValueType;
+
+        private:
+            const BUFFER& image_;
+            std::vector<ValueType> row_;
+
+        public:
+            explicit RowSource(const BUFFER& image): image_(image), row_(image.getWidth()){}
+
+            const ValueType* getRow(unsigned y)
+            {
+                auto row = image_[static_cast<int>(y)];
+                for(unsigned x = 0; x < image_.getWidth(); x++) row_[x] = row[x];
+                return row_.data();
+            }
+        };
+
+        /**
+         * Источник строк ImageBuffer (при линейном расположении - строки буфера без копирования)
+         */
+        template<typename T, typename LAYOUT, typename STORAGE>
+        class RowSource<ImageBuffer<T, LAYOUT, STORAGE>>
+        {
+        public:
+            using ValueType = T;
+
+        private:
+            const ImageBuffer<T, LAYOUT, STORAGE>& image_;
+            /// Линейная копия (только при отложенной очистке - copyToLinear учитывает неразрешенные тайлы)
+            std::vector<T> linear_;
+            std::vector<T> row_;
+
+        public:
+            explicit RowSource(const ImageBuffer<T, LAYOUT, STORAGE>& image): image_(image)
+            {
+                if(image.hasPendingClear()){
+                    linear_.resize(static_cast<size_t>(image.getWidth()) * image.getHeight());
+                    image.copyToLinear(linear_.data(), image.getWidth());
+                }
+                else if(!LAYOUT::kContiguousRows){
+                    row_.resize(image.getWidth());
+                }
+            }
+
+            const T* getRow(unsigned y)
+            {
+                if(!linear_.empty()) return linear_.data() + static_cast<size_t>(y) * image_.getWidth();
+                if(LAYOUT::kContiguousRows) return image_.getData() + static_cast<size_t>(image_.getPitch()) * y;
+
+                auto row = image_[static_cast<int>(y)];
+                for(unsigned x = 0; x < image_.getWidth(); x++) row_[x] = row[x];
+                return row_.data();
+            }
+        };
+
+        /**
+         * Источник строк ImageBufferView (строки без копирования)
+         */
+        template<typename T>
+        class RowSource<ImageBufferView<T>>
+        {
+        public:
+            using ValueType = typename ImageBufferView<T>::ValueType;
+
+        private:
+            const ImageBufferView<T>& image_;
+
+        public:
+            explicit RowSource(const ImageBufferView<T>& image): image_(image){}
+
+            const ValueType* getRow(unsigned y)
+            {
+                return image_[static_cast<int>(y)];
+            }
+        };
+
+        /**
+         * Приемник строк декодируемого изображения (при линейном расположении - строки буфера без копирования)
+         */
+        template<typename T, typename LAYOUT, typename STORAGE>
+        class RowTarget
+        {
+        private:
+            ImageBuffer<T, LAYOUT, STORAGE>& image_;
+            std::vector<T> row_;
+
+        public:
+            explicit RowTarget(ImageBuffer<T, LAYOUT, STORAGE>& image): image_(image){}
+
+            /**
+             * Подготовить буфер (память переиспользуется, если размеры не изменились)
+             * @param width Ширина
+             * @param height Высота
+             */
+            void prepare(unsigned width, unsigned height)
+            {
+                image_.resize(width, height);
+                if(!LAYOUT::kContiguousRows) row_.resize(width);
+            }
+
+            /**
+             * Получить строку для записи пикселей
+             * @param y Номер строки
+             * @return Указатель на первый пиксель строки
+             */
+            T* getRow(unsigned y)
+            {
+                if(LAYOUT::kContiguousRows) return image_.getData() + static_cast<size_t>(image_.getPitch()) * y;
+                return row_.data();
+            }
+
+            /**
+             * Завершить запись строки
+             * @param y Номер строки
+             */
+            void commitRow(unsigned y)
+            {
+                if(LAYOUT::kContiguousRows) return;
+
+                auto row = image_[static_cast<int>(y)];
+                for(unsigned x = 0; x < image_.getWidth(); x++) row[x] = row_[x];
+            }
+        };
+
+        inline void PutLE16(uint8_t* out, uint32_t value)
+        {
+            out[0] = static_cast<uint8_t>(value);
+            out[1] = static_cast<uint8_t>(value >> 8u);
+        }
+
+        inline void PutLE32(uint8_t* out, uint32_t value)
+        {
+            out[0] = static_cast<uint8_t>(value);
+            out[1] = static_cast<uint8_t>(value >> 8u);
+            out[2] = static_cast<uint8_t>(value >> 16u);
+            out[3] = static_cast<uint8_t>(value >> 24u);
+        }
+
+        inline void PutBE32(uint8_t* out, uint32_t value)
+        {
+            out[0] = static_cast<uint8_t>(value >> 24u);
+            out[1] = static_cast<uint8_t>(value >> 16u);
+            out[2] = static_cast<uint8_t>(value >> 8u);
+            out[3] = static_cast<uint8_t>(value);
+        }
+
+        inline uint32_t GetLE16(const uint8_t* in)
+        {
+            return static_cast<uint32_t>(in[0]) | (static_cast<uint32_t>(in[1]) << 8u);
+        }
+
+        inline uint32_t GetLE32(const uint8_t* in)
+        {
+            return static_cast<uint32_t>(in[0]) | (static_cast<uint32_t>(in[1]) << 8u) |
+                   (static_cast<uint32_t>(in[2]) << 16u) | (static_cast<uint32_t>(in[3]) << 24u);
+        }
+
+        inline uint32_t GetBE32(const uint8_t* in)
+        {
+            return (static_cast<uint32_t>(in[0]) << 24u) | (static_cast<uint32_t>(in[1]) << 16u) |
+                   (static_cast<uint32_t>(in[2]) << 8u) | static_cast<uint32_t>(in[3]);
+        }
+
+        /**
+         * Сообщить о некорректных или неподдерживаемых данных изображения
+         * @param what Описание
+         */
+        [[noreturn]] inline void ImageFormatError(const char* what)
+        {
+            throw std::runtime_error(std::string("Image decode error: ") + what);
+        }
+
+        /**
+         * Проверить размеры изображения (не больше 2^28 пикселей и 2^30 байт в строке)
+         * @param width Ширина
+         * @param height Высота
+         */
+        inline void CheckImageSize(uint64_t width, uint64_t height)
+        {
+            if(width == 0 || height == 0) ImageFormatError("empty image");
+            if(width > (1u << 28u) || height > (1u << 28u) || width * height > (1u << 28u)) ImageFormatError("image is too large");
+        }
+
+        /**
+         * Запись PPM (P6)
+         */
+        template<typename SOURCE, typename SINK>
+        void EncodePPM(SOURCE& source, unsigned width, unsigned height, SINK& sink)
+        {
+            using T = typename SOURCE::ValueType;
+
+            char header[64];
+            int length = std::snprintf(header, sizeof(header), "P6\n%u %u\n255\n", width, height);
+            sink.write(header, static_cast<size_t>(length));
+
+            std::vector<uint8_t> row(static_cast<size_t>(width) * 3);
+            for(unsigned y = 0; y < height; y++)
+            {
+                const T* src = source.getRow(y);
+                uint8_t* dst = row.data();
+                for(unsigned x = 0; x < width; x++, dst += 3)
+                {
+                    uint8_t rgba[4];
+                    PixelTraits<T>::ToRGBA8(src[x], rgba);
+                    dst[0] = rgba[0];
+                    dst[1] = rgba[1];
+                    dst[2] = rgba[2];
+                }
+                sink.write(row.data(), row.size());
+            }
+        }
+
+        /**
+         * Чтение PPM (P5 - оттенки серого, P6 - RGB, глубина до 8 бит)
+         */
+        template<typename TARGET, typename T>
+        void DecodePPM(const uint8_t* data, size_t size, TARGET& target)
+        {
+            size_t pos = 2;
+
+            // Числа заголовка разделены пробельными символами, комментарии - от '#' до конца строки
+            auto readNumber = [&]() -> uint64_t {
+                while(pos < size){
+                    if(data[pos] == '#'){
+                        while(pos < size && data[pos] != '\n') pos++;
+                    }
+                    else if(data[pos] == ' ' || data[pos] == '\t' || data[pos] == '\r' || data[pos] == '\n'){
+                        pos++;
+                    }
+                    else break;
+                }
+                if(pos >= size || data[pos] < '0' || data[pos] > '9') ImageFormatError("invalid PPM header");
+
+                uint64_t value = 0;
+                while(pos < size && data[pos] >= '0' && data[pos] <= '9' && value < (1ull << 32u)){
+                    value = value * 10 + static_cast<uint64_t>(data[pos++] - '0');
+                }
+                return value;
+            };
+
+            if(size < 2 || data[0] != 'P' || (data[1] != '5' && data[1] != '6')) ImageFormatError("unsupported PPM type");
+            const unsigned channels = data[1] == '6' ? 3 : 1;
+
+            const uint64_t width = readNumber();
+            const uint64_t height = readNumber();
+            const uint64_t maxValue = readNumber();
+            CheckImageSize(width, height);
+            if(maxValue == 0 || maxValue > 255) ImageFormatError("unsupported PPM depth");
+
+            // Ровно один пробельный символ после заголовка
+            pos++;
+            const size_t rowBytes = static_cast<size_t>(width) * channels;
+            if(pos > size || size - pos < rowBytes * height) ImageFormatError("truncated PPM data");
+
+            target.prepare(static_cast<unsigned>(width), static_cast<unsigned>(height));
+            const uint8_t* src = data + pos;
+
+            for(unsigned y = 0; y < height; y++)
+            {
+                T* dst = target.getRow(y);
+                for(unsigned x = 0; x < width; x++, src += channels)
+                {
+                    uint8_t rgba[4] = {src[0], src[channels == 3 ? 1 : 0], src[channels == 3 ? 2 : 0], 255};
+                    if(maxValue != 255){
+                        for(int c = 0; c < 3; c++) rgba[c] = static_cast<uint8_t>(std::min<uint64_t>(rgba[c], maxValue) * 255 / maxValue);
+                    }
+                    dst[x] = PixelTraits<T>::FromRGBA8(rgba);
+                }
+                target.commitRow(y);
+            }
+        }
+
+        /**
+         * Запись TGA (32 бит BGRA без сжатия, строки сверху вниз)
+         */
+        template<typename SOURCE, typename SINK>
+        void EncodeTGA(SOURCE& source, unsigned width, unsigned height, SINK& sink)
+        {
+            using T = typename SOURCE::ValueType;
+            if(width > 0xFFFFu || height > 0xFFFFu) throw std::runtime_error("Image encode error: TGA image is larger than 65535 pixels");
+
+            uint8_t header[18] = {};
+            header[2] = 2;
+            PutLE16(header + 12, width);
+            PutLE16(header + 14, height);
+            header[16] = 32;
+            header[17] = 0x28;
+            sink.write(header, sizeof(header));
+
+            std::vector<uint8_t> row(static_cast<size_t>(width) * 4);
+            for(unsigned y = 0; y < height; y++)
+            {
+                const T* src = source.getRow(y);
+                uint8_t* dst = row.data();
+                for(unsigned x = 0; x < width; x++, dst += 4)
+                {
+                    uint8_t rgba[4];
+                    PixelTraits<T>::ToRGBA8(src[x], rgba);
+                    dst[0] = rgba[2];
+                    dst[1] = rgba[1];
+                    dst[2] = rgba[0];
+                    dst[3] = rgba[3];
+                }
+                sink.write(row.data(), row.size());
+            }
+
+            // Подвал TGA 2.0
+            static const uint8_t kFooter[26] = {0,0,0,0, 0,0,0,0, 'T','R','U','E','V','I','S','I','O','N','-','X','F','I','L','E','.',0};
+            sink.write(kFooter, sizeof(kFooter));
+        }
+
+        /**
+         * Чтение TGA (типы 2, 3, 10, 11: 8 бит оттенки серого, 24/32 бит BGR(A), с RLE и без)
+         */
+        template<typename TARGET, typename T>
+        void DecodeTGA(const uint8_t* data, size_t size, TARGET& target)
+        {
+            if(size < 18) ImageFormatError("truncated TGA header");
+
+            const unsigned idLength = data[0];
+            const unsigned colorMapType = data[1];
+            const unsigned imageType = data[2];
+            const unsigned width = GetLE16(data + 12);
+            const unsigned height = GetLE16(data + 14);
+            const unsigned bits = data[16];
+            const bool topDown = (data[17] & 0x20u) != 0;
+
+            if(colorMapType != 0) ImageFormatError("color-mapped TGA is not supported");
+            const bool rle = imageType == 10 || imageType == 11;
+            const bool gray = imageType == 3 || imageType == 11;
+            if(imageType != 2 && imageType != 3 && !rle) ImageFormatError("unsupported TGA type");
+            if(gray ? bits != 8 : (bits != 24 && bits != 32)) ImageFormatError("unsupported TGA depth");
+            CheckImageSize(width, height);
+
+            const unsigned pixelBytes = bits / 8;
+            size_t pos = 18 + idLength;
+            if(pos > size) ImageFormatError("truncated TGA data");
+            if(!rle && size - pos < static_cast<size_t>(width) * height * pixelBytes) ImageFormatError("truncated TGA data");
+
+            auto readPixel = [&](const uint8_t* src) -> T {
+                uint8_t rgba[4];
+                if(gray){
+                    rgba[0] = rgba[1] = rgba[2] = src[0];
+                    rgba[3] = 255;
+                }
+                else{
+                    rgba[0] = src[2];
+                    rgba[1] = src[1];
+                    rgba[2] = src[0];
+                    rgba[3] = pixelBytes == 4 ? src[3] : 255;
+                }
+                return PixelTraits<T>::FromRGBA8(rgba);
+            };
+
+            target.prepare(width, height);
+
+            // Состояние RLE-пакета (пакеты могут переходить через границу строки)
+            unsigned packetLeft = 0;
+            bool packetRepeat = false;
+            T repeatValue{};
+
+            for(unsigned row = 0; row < height; row++)
+            {
+                const unsigned y = topDown ? row : height - 1 - row;
+                T* dst = target.getRow(y);
+
+                if(!rle){
+                    for(unsigned x = 0; x < width; x++, pos += pixelBytes) dst[x] = readPixel(data + pos);
+                }
+                else{
+                    for(unsigned x = 0; x < width; x++)
+                    {
+                        if(packetLeft == 0){
+                            if(pos >= size) ImageFormatError("truncated TGA data");
+                            const uint8_t packet = data[pos++];
+                            packetLeft = (packet & 0x7Fu) + 1;
+                            packetRepeat = (packet & 0x80u) != 0;
+                            if(packetRepeat){
+                                if(size - pos < pixelBytes) ImageFormatError("truncated TGA data");
+                                repeatValue = readPixel(data + pos);
+                                pos += pixelBytes;
+                            }
+                        }
+
+                        if(packetRepeat){
+                            dst[x] = repeatValue;
+                        }
+                        else{
+                            if(size - pos < pixelBytes) ImageFormatError("truncated TGA data");
+                            dst[x] = readPixel(data + pos);
+                            pos += pixelBytes;
+                        }
+                        packetLeft--;
+                    }
+                }
+
+                target.commitRow(y);
+            }
+        }
+
+        /**
+         * Запись BMP (32 бит BI_BITFIELDS с альфа-каналом, заголовок BITMAPV4HEADER, строки снизу вверх)
+         */
+        template<typename SOURCE, typename SINK>
+        void EncodeBMP(SOURCE& source, unsigned width, unsigned height, SINK& sink)
+        {
+            using T = typename SOURCE::ValueType;
+
+            const uint64_t imageSize = static_cast<uint64_t>(width) * height * 4;
+            const uint32_t headerSize = 14 + 108;
+            if(imageSize + headerSize > 0xFFFFFFFFull || width > 0x7FFFFFFFu || height > 0x7FFFFFFFu){
+                throw std::runtime_error("Image encode error: BMP image is too large");
+            }
+
+            uint8_t header[headerSize] = {};
+            header[0] = 'B';
+            header[1] = 'M';
+            PutLE32(header + 2, static_cast<uint32_t>(headerSize + imageSize));
+            PutLE32(header + 10, headerSize);
+
+            uint8_t* info = header + 14;
+            PutLE32(info + 0, 108);
+            PutLE32(info + 4, width);
+            PutLE32(info + 8, height);
+            PutLE16(info + 12, 1);
+            PutLE16(info + 14, 32);
+            PutLE32(info + 16, 3);
+            PutLE32(info + 20, static_cast<uint32_t>(imageSize));
+            PutLE32(info + 24, 2835);
+            PutLE32(info + 28, 2835);
+            PutLE32(info + 40, 0x00FF0000u);
+            PutLE32(info + 44, 0x0000FF00u);
+            PutLE32(info + 48, 0x000000FFu);
+            PutLE32(info + 52, 0xFF000000u);
+            PutLE32(info + 56, 0x73524742u);
+            sink.write(header, sizeof(header));
+
+            std::vector<uint8_t> row(static_cast<size_t>(width) * 4);
+            for(unsigned i = 0; i < height; i++)
+            {
+                const T* src = source.getRow(height - 1 - i);
+                uint8_t* dst = row.data();
+                for(unsigned x = 0; x < width; x++, dst += 4)
+                {
+                    uint8_t rgba[4];
+                    PixelTraits<T>::ToRGBA8(src[x], rgba);
+                    dst[0] = rgba[2];
+                    dst[1] = rgba[1];
+                    dst[2] = rgba[0];
+                    dst[3] = rgba[3];
+                }
+                sink.write(row.data(), row.size());
+            }
+        }
+
+        /**
+         * Канал пикселя BMP, заданный битовой маской
+         */
+        struct BitField
+        {
+            uint32_t mask = 0;
+            unsigned shift = 0;
+            unsigned bits = 0;
+
+            explicit BitField(uint32_t value = 0): mask(value)
+            {
+                if(mask == 0) return;
+                while(((mask >> shift) & 1u) == 0) shift++;
+                while(shift + bits < 32 && ((mask >> (shift + bits)) & 1u) != 0) bits++;
+            }
+
+            /**
+             * Получить значение канала (8 бит)
+             * @param pixel Пиксель
+             * @param fallback Значение при отсутствии канала
+             * @return Значение
+             */
+            [[nodiscard]] uint8_t extract(uint32_t pixel, uint8_t fallback) const
+            {
+                if(bits == 0) return fallback;
+                uint32_t value = (pixel & mask) >> shift;
+                if(bits >= 8) return static_cast<uint8_t>(value >> (bits - 8));
+                return static_cast<uint8_t>(value * 255u / ((1u << bits) - 1u));
+            }
+        };
+
+        /**
+         * Чтение BMP (24 бит BI_RGB, 32 бит BI_RGB/BI_BITFIELDS, строки снизу вверх или сверху вниз)
+         */
+        template<typename TARGET, typename T>
+        void DecodeBMP(const uint8_t* data, size_t size, TARGET& target)
+        {
+            if(size < 14 + 40 || data[0] != 'B' || data[1] != 'M') ImageFormatError("invalid BMP header");
+
+            const uint32_t offset = GetLE32(data + 10);
+            const uint8_t* info = data + 14;
+            const uint32_t infoSize = GetLE32(info);
+            if(infoSize < 40 || 14 + static_cast<size_t>(infoSize) > size) ImageFormatError("unsupported BMP header");
+
+            const auto width = static_cast<int32_t>(GetLE32(info + 4));
+            const auto rawHeight = static_cast<int32_t>(GetLE32(info + 8));
+            const unsigned bits = GetLE16(info + 14);
+            const uint32_t compression = GetLE32(info + 16);
+            const bool topDown = rawHeight < 0;
+            const int64_t height = topDown ? -static_cast<int64_t>(rawHeight) : rawHeight;
+
+            if(width <= 0) ImageFormatError("invalid BMP size");
+            CheckImageSize(static_cast<uint64_t>(width), static_cast<uint64_t>(height));
+            if(bits != 24 && bits != 32) ImageFormatError("unsupported BMP depth");
+
+            // Маски каналов: BI_RGB - стандартные (без альфа-канала), BI_BITFIELDS/BI_ALPHABITFIELDS - из заголовка
+            BitField red(0x00FF0000u), green(0x0000FF00u), blue(0x000000FFu), alpha(0);
+            if(compression == 3 || compression == 6){
+                if(bits != 32) ImageFormatError("unsupported BMP bit fields");
+                const uint8_t* masks = info + 40;
+                const size_t masksEnd = 14 + static_cast<size_t>(std::max<uint32_t>(infoSize, 40 + (compression == 6 ? 16u : 12u)));
+                if(masksEnd > size) ImageFormatError("truncated BMP header");
+                red = BitField(GetLE32(masks));
+                green = BitField(GetLE32(masks + 4));
+                blue = BitField(GetLE32(masks + 8));
+                if(infoSize >= 56 || compression == 6) alpha = BitField(GetLE32(masks + 12));
+            }
+            else if(compression != 0){
+                ImageFormatError("compressed BMP is not supported");
+            }
+
+            const unsigned pixelBytes = bits / 8;
+            const size_t stride = (static_cast<size_t>(width) * bits + 31) / 32 * 4;
+            if(offset > size || (size - offset) / stride < static_cast<size_t>(height)) ImageFormatError("truncated BMP data");
+
+            const bool standard = red.mask == 0x00FF0000u && green.mask == 0x0000FF00u && blue.mask == 0x000000FFu &&
+                                  (alpha.mask == 0 || alpha.mask == 0xFF000000u);
+
+            target.prepare(static_cast<unsigned>(width), static_cast<unsigned>(height));
+
+            for(unsigned row = 0; row < height; row++)
+            {
+                const unsigned y = topDown ? row : static_cast<unsigned>(height) - 1 - row;
+                const uint8_t* src = data + offset + stride * row;
+                T* dst = target.getRow(y);
+
+                for(unsigned x = 0; x < static_cast<unsigned>(width); x++, src += pixelBytes)
+                {
+                    uint8_t rgba[4];
+                    if(standard){
+                        rgba[0] = src[2];
+                        rgba[1] = src[1];
+                        rgba[2] = src[0];
+                        rgba[3] = alpha.mask != 0 ? src[3] : 255;
+                    }
+                    else{
+                        const uint32_t pixel = GetLE32(src);
+                        rgba[0] = red.extract(pixel, 0);
+                        rgba[1] = green.extract(pixel, 0);
+                        rgba[2] = blue.extract(pixel, 0);
+                        rgba[3] = alpha.extract(pixel, 255);
+                    }
+                    dst[x] = PixelTraits<T>::FromRGBA8(rgba);
+                }
+
+                target.commitRow(y);
+            }
+        }
+
+        /**
+         * Пиксель QOI
+         */
+        struct QoiPixel
+        {
+            uint8_t r, g, b, a;
+
+            bool operator==(const QoiPixel& other) const
+            {
+                return r == other.r && g == other.g && b == other.b && a == other.a;
+            }
+
+            [[nodiscard]] unsigned hash() const
+            {
+                return (r * 3u + g * 5u + b * 7u + a * 11u) % 64u;
+            }
+        };
+
+        /**
+         * Запись QOI (4 канала, sRGB)
+         */
+        template<typename SOURCE, typename SINK>
+        void EncodeQOI(SOURCE& source, unsigned width, unsigned height, SINK& sink)
+        {
+            using T = typename SOURCE::ValueType;
+
+            uint8_t header[14];
+            memcpy(header, "qoif", 4);
+            PutBE32(header + 4, width);
+            PutBE32(header + 8, height);
+            header[12] = 4;
+            header[13] = 0;
+            sink.write(header, sizeof(header));
+
+            QoiPixel index[64] = {};
+            QoiPixel previous = {0, 0, 0, 255};
+            unsigned run = 0;
+
+            // Строка кодируется не более чем в 5 байт на пиксель
+            std::vector<uint8_t> out(static_cast<size_t>(width) * 5 + 1);
+
+            for(unsigned y = 0; y < height; y++)
+            {
+                const T* src = source.getRow(y);
+                const bool lastRow = y + 1 == height;
+                size_t length = 0;
+
+                for(unsigned x = 0; x < width; x++)
+                {
+                    uint8_t rgba[4];
+                    PixelTraits<T>::ToRGBA8(src[x], rgba);
+                    const QoiPixel pixel = {rgba[0], rgba[1], rgba[2], rgba[3]};
+
+                    if(pixel == previous){
+                        run++;
+                        if(run == 62 || (lastRow && x + 1 == width)){
+                            out[length++] = static_cast<uint8_t>(0xC0u | (run - 1));
+                            run = 0;
+                        }
+                        continue;
+                    }
+
+                    if(run > 0){
+                        out[length++] = static_cast<uint8_t>(0xC0u | (run - 1));
+                        run = 0;
+                    }
+
+                    const unsigned hash = pixel.hash();
+                    if(index[hash] == pixel){
+                        out[length++] = static_cast<uint8_t>(hash);
+                    }
+                    else{
+                        index[hash] = pixel;
+
+                        if(pixel.a == previous.a){
+                            const auto dr = static_cast<int8_t>(pixel.r - previous.r);
+                            const auto dg = static_cast<int8_t>(pixel.g - previous.g);
+                            const auto db = static_cast<int8_t>(pixel.b - previous.b);
+                            const int drg = dr - dg;
+                            const int dbg = db - dg;
+
+                            if(dr > -3 && dr < 2 && dg > -3 && dg < 2 && db > -3 && db < 2){
+                                out[length++] = static_cast<uint8_t>(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+                            }
+                            else if(drg > -9 && drg < 8 && dg > -33 && dg < 32 && dbg > -9 && dbg < 8){
+                                out[length++] = static_cast<uint8_t>(0x80 | (dg + 32));
+                                out[length++] = static_cast<uint8_t>((drg + 8) << 4 | (dbg + 8));
+                            }
+                            else{
+                                out[length++] = 0xFE;
+                                out[length++] = pixel.r;
+                                out[length++] = pixel.g;
+                                out[length++] = pixel.b;
+                            }
+                        }
+                        else{
+                            out[length++] = 0xFF;
+                            out[length++] = pixel.r;
+                            out[length++] = pixel.g;
+                            out[length++] = pixel.b;
+                            out[length++] = pixel.a;
+                        }
+                    }
+
+                    previous = pixel;
+                }
+
+                sink.write(out.data(), length);
+            }
+
+            static const uint8_t kEnd[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+            sink.write(kEnd, sizeof(kEnd));
+        }
+
+        /**
+         * Чтение QOI
+         */
+        template<typename TARGET, typename T>
+        void DecodeQOI(const uint8_t* data, size_t size, TARGET& target)
+        {
+            if(size < 14 + 8 || memcmp(data, "qoif", 4) != 0) ImageFormatError("invalid QOI header");
+
+            const uint32_t width = GetBE32(data + 4);
+            const uint32_t height = GetBE32(data + 8);
+            if(data[12] != 3 && data[12] != 4) ImageFormatError("invalid QOI channels");
+            CheckImageSize(width, height);
+
+            // Данные заканчиваются 8-байтовым маркером конца
+            const size_t end = size - 8;
+            size_t pos = 14;
+
+            QoiPixel index[64] = {};
+            QoiPixel pixel = {0, 0, 0, 255};
+            unsigned run = 0;
+
+            target.prepare(width, height);
+
+            for(unsigned y = 0; y < height; y++)
+            {
+                T* dst = target.getRow(y);
+
+                for(unsigned x = 0; x < width; x++)
+                {
+                    if(run > 0){
+                        run--;
+                    }
+                    else{
+                        if(pos >= end) ImageFormatError("truncated QOI data");
+                        const uint8_t op = data[pos++];
+
+                        if(op == 0xFE){
+                            if(end - pos < 3) ImageFormatError("truncated QOI data");
+                            pixel.r = data[pos];
+                            pixel.g = data[pos + 1];
+                            pixel.b = data[pos + 2];
+                            pos += 3;
+                        }
+                        else if(op == 0xFF){
+                            if(end - pos < 4) ImageFormatError("truncated QOI data");
+                            pixel.r = data[pos];
+                            pixel.g = data[pos + 1];
+                            pixel.b = data[pos + 2];
+                            pixel.a = data[pos + 3];
+                            pos += 4;
+                        }
+                        else if((op & 0xC0u) == 0x00){
+                            pixel = index[op];
+                        }
+                        else if((op & 0xC0u) == 0x40){
+                            pixel.r = static_cast<uint8_t>(pixel.r + ((op >> 4u) & 3u) - 2);
+                            pixel.g = static_cast<uint8_t>(pixel.g + ((op >> 2u) & 3u) - 2);
+                            pixel.b = static_cast<uint8_t>(pixel.b + (op & 3u) - 2);
+                        }
+                        else if((op & 0xC0u) == 0x80){
+                            if(pos >= end) ImageFormatError("truncated QOI data");
+                            const uint8_t next = data[pos++];
+                            const int dg = static_cast<int>(op & 0x3Fu) - 32;
+                            pixel.r = static_cast<uint8_t>(pixel.r + dg - 8 + ((next >> 4u) & 0x0Fu));
+                            pixel.g = static_cast<uint8_t>(pixel.g + dg);
+                            pixel.b = static_cast<uint8_t>(pixel.b + dg - 8 + (next & 0x0Fu));
+                        }
+                        else{
+                            run = op & 0x3Fu;
+                        }
+
+                        index[pixel.hash()] = pixel;
+                    }
+
+                    const uint8_t rgba[4] = {pixel.r, pixel.g, pixel.b, pixel.a};
+                    dst[x] = PixelTraits<T>::FromRGBA8(rgba);
+                }
+
+                target.commitRow(y);
+            }
+        }
+
+        /**
+         * Записать изображение в заданном формате
+         */
+        template<typename BUFFER, typename SINK>
+        void EncodeImage(const BUFFER& image, ImageFormat format, SINK& sink)
+        {
+            RowSource<BUFFER> source(image);
+            const unsigned width = image.getWidth();
+            const unsigned height = image.getHeight();
+
+            switch(format)
+            {
+                case ImageFormat::ePPM: EncodePPM(source, width, height, sink); break;
+                case ImageFormat::eTGA: EncodeTGA(source, width, height, sink); break;
+                case ImageFormat::eBMP: EncodeBMP(source, width, height, sink); break;
+                case ImageFormat::eQOI: EncodeQOI(source, width, height, sink); break;
+                default: throw std::runtime_error("Image encode error: unknown image format");
+            }
+        }
+    }
+
+    /**
+     * Закодировать изображение в массив байт
+     * @tparam BUFFER Тип буфера изображения (ImageBuffer, ImageBufferView, SparseImageBuffer)
+     * @param image Изображение (для типа пикселей требуется специализация PixelTraits)
+     * @param format Формат
+     * @param out Массив байт (данные добавляются в конец)
+     */
+    template<typename BUFFER>
+    void EncodeImage(const BUFFER& image, ImageFormat format, std::vector<uint8_t>& out)
+    {
+        detail::VectorSink sink(out);
+        detail::EncodeImage(image, format, sink);
+    }
+
+    /**
+     * Записать изображение в файл
+     * @details Строки преобразуются и записываются по одной прямо из памяти буфера (без копии всего изображения)
+     * @tparam BUFFER Тип буфера изображения (ImageBuffer, ImageBufferView, SparseImageBuffer)
+     * @param path Путь к файлу
+     * @param image Изображение (для типа пикселей требуется специализация PixelTraits)
+     * @param format Формат (eUnknown - по расширению файла)
+     */
+    template<typename BUFFER>
+    void WriteImage(const std::string& path, const BUFFER& image, ImageFormat format = ImageFormat::eUnknown)
+    {
+        if(format == ImageFormat::eUnknown) format = GetImageFormat(path);
+        if(format == ImageFormat::eUnknown) throw std::runtime_error("Image encode error: unknown image file extension: " + path);
+
+        detail::FileSink sink(path);
+        detail::EncodeImage(image, format, sink);
+        sink.close();
+    }
+
+    /**
+     * Декодировать изображение из памяти
+     * @details Строки декодируются прямо в память буфера. Буфер приводится к размерам изображения (память
+     * переиспользуется, если размеры совпадают). При ошибке бросается std::runtime_error.
+     * @param data Данные файла
+     * @param size Размер данных
+     * @param image Буфер изображения (для типа пикселей требуется специализация PixelTraits)
+     * @param format Формат (eUnknown - по сигнатуре данных)
+     */
+    template<typename T, typename LAYOUT, typename STORAGE>
+    void DecodeImage(const uint8_t* data, size_t size, ImageBuffer<T, LAYOUT, STORAGE>& image, ImageFormat format = ImageFormat::eUnknown)
+    {
+        if(format == ImageFormat::eUnknown) format = DetectImageFormat(data, size);
+
+        detail::RowTarget<T, LAYOUT, STORAGE> target(image);
+        switch(format)
+        {
+            case ImageFormat::ePPM: detail::DecodePPM<decltype(target), T>(data, size, target); break;
+            case ImageFormat::eTGA: detail::DecodeTGA<decltype(target), T>(data, size, target); break;
+            case ImageFormat::eBMP: detail::DecodeBMP<decltype(target), T>(data, size, target); break;
+            case ImageFormat::eQOI: detail::DecodeQOI<decltype(target), T>(data, size, target); break;
+            default: detail::ImageFormatError("unknown image format");
+        }
+    }
+
+    /**
+     * Прочитать изображение из файла
+     * @details Файл отображается в память и декодируется построчно прямо в буфер, без промежуточных копий
+     * @param path Путь к файлу
+     * @param image Буфер изображения
+     * @param format Формат (eUnknown - по расширению файла, затем по сигнатуре данных)
+     */
+    template<typename T, typename LAYOUT, typename STORAGE>
+    void ReadImage(const std::string& path, ImageBuffer<T, LAYOUT, STORAGE>& image, ImageFormat format = ImageFormat::eUnknown)
+    {
+        if(format == ImageFormat::eUnknown) format = GetImageFormat(path);
+
+        detail::MappedInputFile file(path);
+        DecodeImage(file.getData(), file.getSize(), image, format);
+    }
+}
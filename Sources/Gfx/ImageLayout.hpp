@@ -0,0 +1,297 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+
+namespace gfx
+{
+    /// Выравнивание начала строк буфера изображения (размер кеш-линии)
+    constexpr size_t kImageRowAlignment = 64;
+
+    /**
+     * Линейное расположение пикселей в памяти (строка за строкой)
+     * @details Строки начинаются с адресов выровненных по kImageRowAlignment байт, строка доступна как обычный указатель
+     */
+    struct LinearLayout
+    {
+        /// Строки непрерывны в памяти
+        static constexpr bool kContiguousRows = true;
+
+        /// Тип строки (обычный указатель)
+        template <typename T>
+        using Row = T*;
+
+        /**
+         * Вычислить длину строки в элементах, при которой каждая строка начинается с выровненного адреса
+         * @tparam T Тип элемента
+         * @param width Ширина изображения
+         * @return Длина строки в элементах
+         */
+        template <typename T>
+        static unsigned Pitch(unsigned width)
+        {
+            // Кол-во элементов, кратное которому длина строки в байтах будет кратна выравниванию
+            size_t unit = 1;
+            while((unit * sizeof(T)) % kImageRowAlignment != 0) unit *= 2;
+
+            return static_cast<unsigned>(((width + unit - 1) / unit) * unit);
+        }
+
+        /**
+         * Кол-во строк выделяемых в памяти
+         * @param height Высота изображения
+         * @return Кол-во строк
+         */
+        static unsigned PaddedHeight(unsigned height)
+        {
+            return height;
+        }
+
+        /**
+         * Получить строку
+         * @tparam T Тип элемента
+         * @param data Указатель на данные
+         * @param pitch Длина строки в элементах
+         * @param y Номер строки
+         * @return Строка
+         */
+        template <typename T>
+        static Row<T> GetRow(T* data, unsigned pitch, int y)
+        {
+            return data + static_cast<ptrdiff_t>(pitch) * y;
+        }
+
+        /**
+         * Копирование в линейный массив (для линейного расположения - построчное копирование)
+         * @tparam T Тип элемента
+         * @param data Указатель на данные
+         * @param pitch Длина строки в элементах
+         * @param width Ширина изображения
+         * @param height Высота изображения
+         * @param dst Массив назначения
+         * @param dstPitch Длина строки массива назначения в элементах
+         */
+        template <typename T>
+        static void CopyToLinear(const T* data, unsigned pitch, unsigned width, unsigned height, T* dst, size_t dstPitch)
+        {
+            for(unsigned y = 0; y < height; y++){
+                memcpy(dst + dstPitch * y, data + static_cast<size_t>(pitch) * y, width * sizeof(T));
+            }
+        }
+    };
+
+    /**
+     * Тайловое расположение пикселей в памяти
+     * @details Изображение разбито на тайлы TILE_SIZE x TILE_SIZE, каждый тайл хранится непрерывно (внутри тайла - строка
+     * за строкой), тайлы идут строка за строкой. Небольшие области изображения занимают меньше кеш-линий, чем при
+     * линейном расположении.
+     * @tparam TILE_SIZE Размер стороны тайла (степень двойки)
+     */
+    template <unsigned TILE_SIZE = 8>
+    struct TiledLayout
+    {
+        static_assert(TILE_SIZE > 0 && (TILE_SIZE & (TILE_SIZE - 1)) == 0, "Tile size must be a power of two");
+
+        /// Строки не непрерывны в памяти (доступ через прокси-объект)
+        static constexpr bool kContiguousRows = false;
+
+        /**
+         * Строка изображения (прокси-объект для доступа к пикселям по X)
+         * @tparam T Тип элемента
+         */
+        template <typename T>
+        struct Row
+        {
+            /// Указатель на строку внутри первого тайла
+            T* base;
+
+            T& operator[](int x) const
+            {
+                auto ux = static_cast<unsigned>(x);
+                return base[static_cast<size_t>(ux / TILE_SIZE) * TILE_SIZE * TILE_SIZE + (ux % TILE_SIZE)];
+            }
+        };
+
+        /**
+         * Длина строки в элементах (ширина, дополненная до целого кол-ва тайлов)
+         * @tparam T Тип элемента
+         * @param width Ширина изображения
+         * @return Длина строки
+         */
+        template <typename T>
+        static unsigned Pitch(unsigned width)
+        {
+            return ((width + TILE_SIZE - 1) / TILE_SIZE) * TILE_SIZE;
+        }
+
+        /**
+         * Кол-во строк выделяемых в памяти (высота, дополненная до целого кол-ва тайлов)
+         * @param height Высота изображения
+         * @return Кол-во строк
+         */
+        static unsigned PaddedHeight(unsigned height)
+        {
+            return ((height + TILE_SIZE - 1) / TILE_SIZE) * TILE_SIZE;
+        }
+
+        /**
+         * Получить строку
+         * @tparam T Тип элемента
+         * @param data Указатель на данные
+         * @param pitch Длина строки в элементах
+         * @param y Номер строки
+         * @return Строка
+         */
+        template <typename T>
+        static Row<T> GetRow(T* data, unsigned pitch, int y)
+        {
+            auto uy = static_cast<unsigned>(y);
+            return {data + static_cast<size_t>(uy / TILE_SIZE) * pitch * TILE_SIZE + (uy % TILE_SIZE) * TILE_SIZE};
+        }
+
+        /**
+         * Перевод в линейный массив (копирование строк тайлов целиком)
+         * @tparam T Тип элемента
+         * @param data Указатель на данные
+         * @param pitch Длина строки в элементах
+         * @param width Ширина изображения
+         * @param height Высота изображения
+         * @param dst Массив назначения
+         * @param dstPitch Длина строки массива назначения в элементах
+         */
+        template <typename T>
+        static void CopyToLinear(const T* data, unsigned pitch, unsigned width, unsigned height, T* dst, size_t dstPitch)
+        {
+            unsigned tilesX = pitch / TILE_SIZE;
+
+            for(unsigned y = 0; y < height; y++)
+            {
+                const T* tileRow = data + static_cast<size_t>(y / TILE_SIZE) * pitch * TILE_SIZE + (y % TILE_SIZE) * TILE_SIZE;
+                T* out = dst + dstPitch * y;
+
+                for(unsigned tx = 0; tx < tilesX; tx++)
+                {
+                    unsigned x = tx * TILE_SIZE;
+                    if(x >= width) break;
+                    memcpy(out + x, tileRow + static_cast<size_t>(tx) * TILE_SIZE * TILE_SIZE, std::min(TILE_SIZE, width - x) * sizeof(T));
+                }
+            }
+        }
+    };
+
+    /**
+     * Расположение пикселей в порядке Мортона (Z-кривая) внутри тайлов
+     * @details Тайлы TILE_SIZE x TILE_SIZE идут строка за строкой, пиксели внутри тайла упорядочены по Z-кривой,
+     * благодаря чему соседние по обеим осям пиксели находятся рядом в памяти.
+     * @tparam TILE_SIZE Размер стороны тайла (степень двойки, не больше 256)
+     */
+    template <unsigned TILE_SIZE = 8>
+    struct MortonLayout
+    {
+        static_assert(TILE_SIZE > 0 && TILE_SIZE <= 256 && (TILE_SIZE & (TILE_SIZE - 1)) == 0, "Tile size must be a power of two not above 256");
+
+        /// Строки не непрерывны в памяти (доступ через прокси-объект)
+        static constexpr bool kContiguousRows = false;
+
+        /**
+         * Распределить биты числа через один (0bABCD -> 0b0A0B0C0D)
+         * @param v Исходное число (не более 8 бит)
+         * @return Результат
+         */
+        static unsigned SpreadBits(unsigned v)
+        {
+            v = (v | (v << 4u)) & 0x0F0Fu;
+            v = (v | (v << 2u)) & 0x3333u;
+            v = (v | (v << 1u)) & 0x5555u;
+            return v;
+        }
+
+        /**
+         * Строка изображения (прокси-объект для доступа к пикселям по X)
+         * @tparam T Тип элемента
+         */
+        template <typename T>
+        struct Row
+        {
+            /// Указатель на начало первого тайла строки тайлов
+            T* base;
+            /// Биты Y-координаты внутри тайла (распределенные по нечетным позициям)
+            unsigned yBits;
+
+            T& operator[](int x) const
+            {
+                auto ux = static_cast<unsigned>(x);
+                return base[static_cast<size_t>(ux / TILE_SIZE) * TILE_SIZE * TILE_SIZE + (SpreadBits(ux % TILE_SIZE) | yBits)];
+            }
+        };
+
+        /**
+         * Длина строки в элементах (ширина, дополненная до целого кол-ва тайлов)
+         * @tparam T Тип элемента
+         * @param width Ширина изображения
+         * @return Длина строки
+         */
+        template <typename T>
+        static unsigned Pitch(unsigned width)
+        {
+            return ((width + TILE_SIZE - 1) / TILE_SIZE) * TILE_SIZE;
+        }
+
+        /**
+         * Кол-во строк выделяемых в памяти (высота, дополненная до целого кол-ва тайлов)
+         * @param height Высота изображения
+         * @return Кол-во строк
+         */
+        static unsigned PaddedHeight(unsigned height)
+        {
+            return ((height + TILE_SIZE - 1) / TILE_SIZE) * TILE_SIZE;
+        }
+
+        /**
+         * Получить строку
+         * @tparam T Тип элемента
+         * @param data Указатель на данные
+         * @param pitch Длина строки в элементах
+         * @param y Номер строки
+         * @return Строка
+         */
+        template <typename T>
+        static Row<T> GetRow(T* data, unsigned pitch, int y)
+        {
+            auto uy = static_cast<unsigned>(y);
+            return {data + static_cast<size_t>(uy / TILE_SIZE) * pitch * TILE_SIZE, SpreadBits(uy % TILE_SIZE) << 1u};
+        }
+
+        /**
+         * Перевод в линейный массив
+         * @tparam T Тип элемента
+         * @param data Указатель на данные
+         * @param pitch Длина строки в элементах
+         * @param width Ширина изображения
+         * @param height Высота изображения
+         * @param dst Массив назначения
+         * @param dstPitch Длина строки массива назначения в элементах
+         */
+        template <typename T>
+        static void CopyToLinear(const T* data, unsigned pitch, unsigned width, unsigned height, T* dst, size_t dstPitch)
+        {
+            // Таблица смещений X-координаты внутри тайла (одна на все строки)
+            unsigned xBits[TILE_SIZE];
+            for(unsigned i = 0; i < TILE_SIZE; i++) xBits[i] = SpreadBits(i);
+
+            for(unsigned y = 0; y < height; y++)
+            {
+                auto row = GetRow(data, pitch, static_cast<int>(y));
+                T* out = dst + dstPitch * y;
+
+                for(unsigned x = 0; x < width; x += TILE_SIZE)
+                {
+                    const T* tile = row.base + static_cast<size_t>(x / TILE_SIZE) * TILE_SIZE * TILE_SIZE;
+                    unsigned count = std::min(TILE_SIZE, width - x);
+                    for(unsigned i = 0; i < count; i++) out[x + i] = tile[xBits[i] | row.yBits];
+                }
+            }
+        }
+    };
+}
@@ -0,0 +1,543 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <cerrno>
+#include <new>
+#include <string>
+#include <utility>
+#include <system_error>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <malloc.h>
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#endif
+
+#include "ImageLayout.hpp"
+
+namespace gfx
+{
+    /**
+     * Выделение выровненного блока памяти
+     * @param size Размер в байтах
+     * @param alignment Выравнивание (степень двойки, кратная sizeof(void*))
+     * @return Указатель на блок памяти
+     */
+    inline void* AlignedAlloc(size_t size, size_t alignment)
+    {
+#if defined(_WIN32)
+        void* ptr = _aligned_malloc(size, alignment);
+#else
+        void* ptr = nullptr;
+        if(posix_memalign(&ptr, alignment, size) != 0) ptr = nullptr;
+#endif
+        if(ptr == nullptr) throw std::bad_alloc();
+        return ptr;
+    }
+
+    /**
+     * Освобождение блока памяти, выделенного AlignedAlloc
+     * @param ptr Указатель на блок памяти
+     */
+    inline void AlignedFree(void* ptr)
+    {
+#if defined(_WIN32)
+        _aligned_free(ptr);
+#else
+        free(ptr);
+#endif
+    }
+
+    /**
+     * Хранилище пикселей буфера изображения в куче (по умолчанию)
+     * @details Интерфейс хранилища: allocate(size) выделяет блок памяти выровненный по kImageRowAlignment байт,
+     * release(ptr, size) освобождает его, flush(ptr, size) сохраняет данные на носитель (если он есть)
+     */
+    struct HeapStorage
+    {
+        /**
+         * Выделить память
+         * @param size Размер в байтах
+         * @return Указатель на блок памяти
+         */
+        void* allocate(size_t size)
+        {
+            return AlignedAlloc(size, kImageRowAlignment);
+        }
+
+        /**
+         * Освободить память
+         * @param ptr Указатель на блок памяти
+         */
+        void release(void* ptr, size_t)
+        {
+            AlignedFree(ptr);
+        }
+
+        /**
+         * Сохранение данных не требуется
+         */
+        void flush(void*, size_t){}
+    };
+
+    /**
+     * Хранилище пикселей буфера изображения в отображаемом в память файле
+     * @details Пиксели хранятся в файле и подгружаются/выгружаются операционной системой постранично, поэтому размер
+     * изображения ограничен адресным пространством и местом на диске, а не объемом ОЗУ. Содержимое файла - сами
+     * данные буфера (getPitch() * высота элементов в порядке расположения буфера, без заголовка), поэтому готовый файл
+     * используется без сериализации. Если файл существует, его содержимое сохраняется (размер приводится к размеру
+     * буфера), новый файл заполнен нулями.
+     *
+     * Хранилище владеет файлом отображения, поэтому не копируется (только перемещается).
+     */
+    class MappedFileStorage
+    {
+    private:
+        /// Путь к файлу
+        std::string path_;
+#if defined(_WIN32)
+        /// Дескриптор файла
+        HANDLE file_ = INVALID_HANDLE_VALUE;
+        /// Дескриптор объекта отображения
+        HANDLE mapping_ = nullptr;
+#else
+        /// Дескриптор файла
+        int fd_ = -1;
+#endif
+
+        /**
+         * Закрыть файл
+         */
+        void close()
+        {
+#if defined(_WIN32)
+            if(mapping_ != nullptr) CloseHandle(mapping_);
+            if(file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+            mapping_ = nullptr;
+            file_ = INVALID_HANDLE_VALUE;
+#else
+            if(fd_ >= 0) ::close(fd_);
+            fd_ = -1;
+#endif
+        }
+
+        /**
+         * Закрыть файл и сообщить об ошибке
+         * @param what Описание операции
+         */
+        [[noreturn]] void fail(const char* what)
+        {
+#if defined(_WIN32)
+            auto code = static_cast<int>(GetLastError());
+            this->close();
+            throw std::system_error(code, std::system_category(), std::string(what) + ": " + path_);
+#else
+            int code = errno;
+            this->close();
+            throw std::system_error(code, std::generic_category(), std::string(what) + ": " + path_);
+#endif
+        }
+
+    public:
+        /**
+         * Конструктор по умолчанию (хранилище без файла, выделение памяти невозможно)
+         */
+        MappedFileStorage() = default;
+
+        /**
+         * Конструктор
+         * @param path Путь к файлу (создается, если не существует)
+         */
+        explicit MappedFileStorage(std::string path): path_(std::move(path)){}
+
+        MappedFileStorage(const MappedFileStorage&) = delete;
+        MappedFileStorage& operator=(const MappedFileStorage&) = delete;
+
+        /**
+         * Конструктор перемещения
+         * @param other Перемещаемый объект
+         */
+        MappedFileStorage(MappedFileStorage&& other) noexcept
+        {
+            *this = std::move(other);
+        }
+
+        /**
+         * Оператор присвоения через перемещение
+         * @param other Перемещаемый объект
+         * @return Ссылка на текущий объект
+         */
+        MappedFileStorage& operator=(MappedFileStorage&& other) noexcept
+        {
+            if(&other == this) return *this;
+
+            this->close();
+            path_ = std::move(other.path_);
+#if defined(_WIN32)
+            std::swap(file_, other.file_);
+            std::swap(mapping_, other.mapping_);
+#else
+            std::swap(fd_, other.fd_);
+#endif
+            return *this;
+        }
+
+        /**
+         * Закрыть файл (отображение к этому моменту должно быть освобождено владельцем через release)
+         */
+        ~MappedFileStorage()
+        {
+            this->close();
+        }
+
+        /**
+         * Открыть файл, привести его к нужному размеру и отобразить в память
+         * @param size Размер в байтах
+         * @return Указатель на начало отображения (выровнен по границе страницы)
+         */
+        void* allocate(size_t size)
+        {
+            if(path_.empty()) throw std::system_error(std::make_error_code(std::errc::invalid_argument), "Mapped image storage has no file");
+            this->close();
+
+#if defined(_WIN32)
+            file_ = CreateFileA(path_.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if(file_ == INVALID_HANDLE_VALUE) this->fail("Unable to open image file");
+
+            LARGE_INTEGER fileSize;
+            fileSize.QuadPart = static_cast<LONGLONG>(size);
+            if(!SetFilePointerEx(file_, fileSize, nullptr, FILE_BEGIN) || !SetEndOfFile(file_)) this->fail("Unable to resize image file");
+
+            auto size64 = static_cast<uint64_t>(size);
+            mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READWRITE, static_cast<DWORD>(size64 >> 32u), static_cast<DWORD>(size64 & 0xFFFFFFFFu), nullptr);
+            if(mapping_ == nullptr) this->fail("Unable to create image file mapping");
+
+            void* ptr = MapViewOfFile(mapping_, FILE_MAP_ALL_ACCESS, 0, 0, size);
+            if(ptr == nullptr) this->fail("Unable to map image file");
+#else
+            fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT, 0644);
+            if(fd_ < 0) this->fail("Unable to open image file");
+
+            if(ftruncate(fd_, static_cast<off_t>(size)) != 0) this->fail("Unable to resize image file");
+
+            void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+            if(ptr == MAP_FAILED) this->fail("Unable to map image file");
+#endif
+            return ptr;
+        }
+
+        /**
+         * Снять отображение и закрыть файл (данные остаются в файле)
+         * @param ptr Указатель на начало отображения
+         * @param size Размер в байтах
+         */
+        void release(void* ptr, size_t size)
+        {
+#if defined(_WIN32)
+            (void)size;
+            UnmapViewOfFile(ptr);
+#else
+            munmap(ptr, size);
+#endif
+            this->close();
+        }
+
+        /**
+         * Записать измененные страницы в файл (синхронно)
+         * @param ptr Указатель на начало отображения
+         * @param size Размер в байтах
+         */
+        void flush(void* ptr, size_t size)
+        {
+#if defined(_WIN32)
+            FlushViewOfFile(ptr, size);
+            FlushFileBuffers(file_);
+#else
+            msync(ptr, size, MS_SYNC);
+#endif
+        }
+
+        /**
+         * Получить путь к файлу
+         * @return
+         */
+        [[nodiscard]] const std::string& getPath() const
+        {
+            return path_;
+        }
+    };
+
+    /**
+     * Пул блоков памяти под пиксели буферов изображений
+     * @details Освобожденные блоки не возвращаются системе, а сохраняются по размеру и выдаются повторно буферам того же
+     * размера (т.е. того же формата и разрешения). Повторно выданные блоки уже отображены в адресное пространство,
+     * поэтому временные буферы и смена разрешения туда-обратно не приводят к выделению памяти и страничным промахам.
+     * Объем сохраненных блоков ограничен - блоки сверх лимита освобождаются сразу.
+     * Методы потокобезопасны.
+     */
+    class ImageMemoryPool
+    {
+    private:
+        /// Мьютекс состояния пула
+        mutable std::mutex mutex_;
+        /// Свободные блоки по размеру в байтах
+        std::unordered_map<size_t, std::vector<void*>> freeBlocks_;
+        /// Суммарный размер свободных блоков
+        size_t cachedSize_ = 0;
+        /// Максимальный суммарный размер свободных блоков
+        size_t maxCachedSize_;
+
+    public:
+        /// Лимит объема свободных блоков по умолчанию
+        static constexpr size_t kDefaultMaxCachedSize = 512u * 1024u * 1024u;
+
+        /**
+         * Конструктор
+         * @param maxCachedSize Максимальный суммарный размер сохраняемых свободных блоков в байтах
+         */
+        explicit ImageMemoryPool(size_t maxCachedSize = kDefaultMaxCachedSize): maxCachedSize_(maxCachedSize){}
+
+        ImageMemoryPool(const ImageMemoryPool&) = delete;
+        ImageMemoryPool& operator=(const ImageMemoryPool&) = delete;
+
+        /**
+         * Освобождение всех сохраненных блоков
+         */
+        ~ImageMemoryPool()
+        {
+            this->trim();
+        }
+
+        /**
+         * Получить блок памяти (сохраненный блок того же размера, либо новый)
+         * @param size Размер в байтах
+         * @return Указатель на блок, выровненный по kImageRowAlignment
+         */
+        void* acquire(size_t size)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = freeBlocks_.find(size);
+                if(it != freeBlocks_.end() && !it->second.empty()){
+                    void* ptr = it->second.back();
+                    it->second.pop_back();
+                    cachedSize_ -= size;
+                    return ptr;
+                }
+            }
+
+            return AlignedAlloc(size, kImageRowAlignment);
+        }
+
+        /**
+         * Вернуть блок памяти в пул
+         * @param ptr Указатель на блок (полученный через acquire)
+         * @param size Размер в байтах
+         */
+        void recycle(void* ptr, size_t size)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if(cachedSize_ + size <= maxCachedSize_){
+                    freeBlocks_[size].push_back(ptr);
+                    cachedSize_ += size;
+                    return;
+                }
+            }
+
+            AlignedFree(ptr);
+        }
+
+        /**
+         * Освободить все сохраненные блоки
+         */
+        void trim()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for(auto& entry : freeBlocks_){
+                for(void* ptr : entry.second) AlignedFree(ptr);
+            }
+            freeBlocks_.clear();
+            cachedSize_ = 0;
+        }
+
+        /**
+         * Получить суммарный размер сохраненных свободных блоков
+         * @return Размер в байтах
+         */
+        [[nodiscard]] size_t getCachedSize() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return cachedSize_;
+        }
+
+        /**
+         * Пул по умолчанию (общий для всех буферов с PooledStorage без явно заданного пула)
+         * @return Ссылка на пул
+         */
+        static ImageMemoryPool& getDefault()
+        {
+            static ImageMemoryPool pool;
+            return pool;
+        }
+    };
+
+    /**
+     * Хранилище пикселей буфера изображения в пуле блоков памяти
+     * @details Память берется из пула и возвращается в него при освобождении (изменении размеров, присвоении,
+     * разрушении буфера). Пул должен существовать дольше буферов, которые его используют.
+     */
+    class PooledStorage
+    {
+    private:
+        /// Указатель на пул
+        ImageMemoryPool* pPool_;
+
+    public:
+        /**
+         * Конструктор
+         * @param pPool Указатель на пул (nullptr - пул по умолчанию)
+         */
+        explicit PooledStorage(ImageMemoryPool* pPool = nullptr):
+                pPool_(pPool != nullptr ? pPool : &ImageMemoryPool::getDefault())
+        {}
+
+        /**
+         * Получить блок памяти из пула
+         * @param size Размер в байтах
+         * @return Указатель на блок памяти
+         */
+        void* allocate(size_t size)
+        {
+            return pPool_->acquire(size);
+        }
+
+        /**
+         * Вернуть блок памяти в пул
+         * @param ptr Указатель на блок памяти
+         * @param size Размер в байтах
+         */
+        void release(void* ptr, size_t size)
+        {
+            pPool_->recycle(ptr, size);
+        }
+
+        /**
+         * Сохранение данных не требуется
+         */
+        void flush(void*, size_t){}
+
+        /**
+         * Получить пул
+         * @return Указатель на пул
+         */
+        [[nodiscard]] ImageMemoryPool* getPool() const
+        {
+            return pPool_;
+        }
+    };
+
+#if !defined(_WIN32)
+    /**
+     * Хранилище пикселей буфера изображения в разделяемой памяти System V
+     * @details Сегмент разделяемой памяти может быть подключен другим процессом (например X-сервером через расширение
+     * MIT-SHM), поэтому кадр выводится без копирования пикселей. Идентификатор сегмента - getSegmentId().
+     * Копия хранилища не разделяет сегмент с оригиналом (выделяет собственный).
+     */
+    class SharedMemoryStorage
+    {
+    private:
+        /// Идентификатор сегмента (-1 - не выделен)
+        int segmentId_ = -1;
+
+    public:
+        SharedMemoryStorage() = default;
+
+        /**
+         * Конструктор копирования (сегмент не копируется)
+         */
+        SharedMemoryStorage(const SharedMemoryStorage&): segmentId_(-1){}
+
+        /**
+         * Конструктор перемещения
+         * @param other Перемещаемый объект
+         */
+        SharedMemoryStorage(SharedMemoryStorage&& other) noexcept: segmentId_(other.segmentId_)
+        {
+            other.segmentId_ = -1;
+        }
+
+        /**
+         * Оператор присвоения через перемещение
+         * @param other Перемещаемый объект
+         * @return Ссылка на текущий объект
+         */
+        SharedMemoryStorage& operator=(SharedMemoryStorage&& other) noexcept
+        {
+            std::swap(segmentId_, other.segmentId_);
+            return *this;
+        }
+
+        SharedMemoryStorage& operator=(const SharedMemoryStorage&) = delete;
+
+        /**
+         * Создать сегмент разделяемой памяти и подключить его
+         * @param size Размер в байтах
+         * @return Указатель на начало сегмента (выровнен по границе страницы)
+         */
+        void* allocate(size_t size)
+        {
+            segmentId_ = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+            if(segmentId_ < 0) throw std::system_error(errno, std::generic_category(), "Unable to create shared memory segment");
+
+            void* ptr = shmat(segmentId_, nullptr, 0);
+            if(ptr == reinterpret_cast<void*>(-1)){
+                int code = errno;
+                shmctl(segmentId_, IPC_RMID, nullptr);
+                segmentId_ = -1;
+                throw std::system_error(code, std::generic_category(), "Unable to attach shared memory segment");
+            }
+
+            return ptr;
+        }
+
+        /**
+         * Отключить и удалить сегмент (другие процессы, подключившие сегмент, сохраняют доступ до его отключения)
+         * @param ptr Указатель на начало сегмента
+         */
+        void release(void* ptr, size_t)
+        {
+            shmdt(ptr);
+            if(segmentId_ >= 0) shmctl(segmentId_, IPC_RMID, nullptr);
+            segmentId_ = -1;
+        }
+
+        /**
+         * Сохранение данных не требуется
+         */
+        void flush(void*, size_t){}
+
+        /**
+         * Получить идентификатор сегмента разделяемой памяти
+         * @return Идентификатор (-1 - память не выделена)
+         */
+        [[nodiscard]] int getSegmentId() const
+        {
+            return segmentId_;
+        }
+    };
+#endif
+}
@@ -0,0 +1,317 @@
+#pragma once
+
+#include "Gfx.hpp"
+
+#include <ThreadPool.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+namespace gfx
+{
+    /// Размер стороны тайла пакетной растеризации линий по умолчанию
+    constexpr int kDefaultLineTileSize = 64;
+
+    /**
+     * Отрезок в координатах экрана
+     */
+    struct Segment
+    {
+        int x0;
+        int y0;
+        int x1;
+        int y1;
+    };
+
+    /**
+     * Пакетная растеризация отрезков с разбиением экрана на тайлы
+     * @details Отрезки отсекаются границами буфера и раскладываются по корзинам тайлов экрана - только тех тайлов,
+     * через которые отрезок действительно проходит (обход по столбцам тайлов вдоль главной оси, а не по описывающему
+     * прямоугольнику). Раскладка выполняется параллельно по непрерывным частям массива отрезков, растеризация -
+     * параллельно по тайлам: каждый тайл рисует свои отрезки с отсечением по своим границам (см. LineSetup - пиксели
+     * на границах тайлов не теряются и не дублируются). В пределах тайла отрезки рисуются в порядке массива, поэтому
+     * результат не зависит от кол-ва потоков и совпадает с последовательными вызовами SetLine.
+     *
+     * Память корзин сохраняется между вызовами draw, поэтому объект выгодно создавать один раз и использовать каждый кадр.
+     * @tparam BUFFER Тип буфера изображения (ImageBuffer с любым расположением или ImageBufferView)
+     */
+    template<typename BUFFER>
+    class LineBatchRenderer
+    {
+    public:
+        using ValueType = typename BUFFER::ValueType;
+
+    private:
+        /// Максимальное кол-во отрезков, раскладываемых за один проход (индексы в корзинах 32-битные)
+        static constexpr size_t kMaxPassSize = 1u << 24u;
+        /// Минимальное кол-во отрезков в одной части раскладки
+        static constexpr size_t kMinChunkSize = 4096;
+
+        /**
+         * Корзины части массива отрезков (сортировка подсчетом по номеру тайла)
+         */
+        struct ChunkBins
+        {
+            /// Пары (тайл, индекс отрезка) в порядке отрезков
+            std::vector<std::pair<uint32_t, uint32_t>> entries;
+            /// Индексы отрезков, упорядоченные по тайлам (внутри тайла - по порядку отрезков)
+            std::vector<uint32_t> indices;
+            /// Начало диапазона каждого тайла в indices (tileCount + 1 элементов)
+            std::vector<uint32_t> offsets;
+        };
+
+        /// Указатель на буфер изображения
+        BUFFER* pBuffer_;
+        /// Указатель на пул потоков (nullptr - растеризация в вызывающем потоке без раскладки)
+        tools::ThreadPool* pThreadPool_;
+        /// Размер стороны тайла в пикселях
+        int tileSize_;
+        /// Кол-во тайлов по горизонтали
+        int tilesX_ = 0;
+        /// Кол-во тайлов по вертикали
+        int tilesY_ = 0;
+        /// Корзины частей массива отрезков
+        std::vector<ChunkBins> chunks_;
+
+        /**
+         * Границы буфера
+         * @return Прямоугольник (границы включительно)
+         */
+        [[nodiscard]] BBox2D<int> getBounds() const
+        {
+            return {{0, 0}, {static_cast<int>(pBuffer_->getWidth()) - 1, static_cast<int>(pBuffer_->getHeight()) - 1}};
+        }
+
+        /**
+         * Разложить часть массива отрезков по корзинам тайлов
+         * @param chunk Корзины части
+         * @param segments Отрезки прохода
+         * @param begin Первый индекс части
+         * @param end Индекс после последнего
+         */
+        void binChunk(ChunkBins& chunk, const Segment* segments, size_t begin, size_t end) const
+        {
+            const BBox2D<int> bounds = this->getBounds();
+            const size_t tileCount = static_cast<size_t>(tilesX_) * tilesY_;
+            const int64_t tileSize = tileSize_;
+
+            chunk.entries.clear();
+
+            for(size_t i = begin; i < end; i++)
+            {
+                Segment s = segments[i];
+                if(!LimitLineCoords(s.x0, s.y0, s.x1, s.y1)) continue;
+
+                const LineSetup line(s.x0, s.y0, s.x1, s.y1);
+                int64_t first, last;
+                if(!line.clipSteps(bounds, first, last)) continue;
+
+                // Столбцы тайлов вдоль главной оси, в каждом - диапазон тайлов по второстепенной оси
+                const int64_t majorFirst = (line.x0 + first) / tileSize;
+                const int64_t majorLast = (line.x0 + last) / tileSize;
+
+                for(int64_t m = majorFirst; m <= majorLast; m++)
+                {
+                    const int64_t kA = std::max(first, m * tileSize - line.x0);
+                    const int64_t kB = std::min(last, (m + 1) * tileSize - 1 - line.x0);
+                    const int minorA = line.minorAt(kA);
+                    const int minorB = line.minorAt(kB);
+
+                    for(int n = std::min(minorA, minorB) / tileSize_; n <= std::max(minorA, minorB) / tileSize_; n++)
+                    {
+                        const auto tile = static_cast<uint32_t>(line.axisSwapped ? m * tilesX_ + n : n * tilesX_ + m);
+                        chunk.entries.emplace_back(tile, static_cast<uint32_t>(i));
+                    }
+                }
+            }
+
+            // Устойчивая сортировка подсчетом по номеру тайла
+            chunk.offsets.assign(tileCount + 1, 0);
+            for(const auto& entry : chunk.entries) chunk.offsets[entry.first + 1]++;
+            for(size_t t = 0; t < tileCount; t++) chunk.offsets[t + 1] += chunk.offsets[t];
+
+            chunk.indices.resize(chunk.entries.size());
+            for(const auto& entry : chunk.entries) chunk.indices[chunk.offsets[entry.first]++] = entry.second;
+
+            // После заполнения offsets[t] указывает на конец диапазона тайла - сдвинуть обратно к началу
+            for(size_t t = tileCount; t > 0; t--) chunk.offsets[t] = chunk.offsets[t - 1];
+            chunk.offsets[0] = 0;
+        }
+
+        /**
+         * Растеризовать отрезки одного тайла
+         * @tparam COLOR_FN Тип функции цвета отрезка (ValueType(size_t index))
+         * @param tileIndex Индекс тайла
+         * @param chunkCount Кол-во частей раскладки
+         * @param segments Отрезки прохода
+         * @param colorFn Функция цвета отрезка по индексу в проходе
+         */
+        template<typename COLOR_FN>
+        void rasterizeTile(size_t tileIndex, size_t chunkCount, const Segment* segments, const COLOR_FN& colorFn)
+        {
+            const int tx = static_cast<int>(tileIndex % tilesX_);
+            const int ty = static_cast<int>(tileIndex / tilesX_);
+
+            const BBox2D<int> bounds = this->getBounds();
+            const BBox2D<int> clip = {
+                    {tx * tileSize_, ty * tileSize_},
+                    {std::min(tx * tileSize_ + tileSize_ - 1, bounds.max.x), std::min(ty * tileSize_ + tileSize_ - 1, bounds.max.y)}
+            };
+
+            bool resolved = false;
+
+            for(size_t c = 0; c < chunkCount; c++)
+            {
+                const ChunkBins& chunk = chunks_[c];
+
+                for(uint32_t k = chunk.offsets[tileIndex]; k < chunk.offsets[tileIndex + 1]; k++)
+                {
+                    // Отложенная очистка всего тайла один раз (тайлы выровнены по kLazyClearTileSize)
+                    if(!resolved){
+                        pBuffer_->resolveRect(clip.min.x, clip.min.y, clip.max.x, clip.max.y);
+                        resolved = true;
+                    }
+
+                    const uint32_t index = chunk.indices[k];
+                    Segment s = segments[index];
+                    LimitLineCoords(s.x0, s.y0, s.x1, s.y1);
+
+                    const LineSetup line(s.x0, s.y0, s.x1, s.y1);
+                    int64_t first, last;
+                    if(!line.clipSteps(clip, first, last)) continue;
+
+                    const ValueType color = colorFn(index);
+                    line.rasterize(first, last, [&](int x, int y){ (*pBuffer_)[y][x] = color; });
+                }
+            }
+        }
+
+        /**
+         * Растеризовать массив отрезков
+         * @tparam COLOR_FN Тип функции цвета отрезка (ValueType(size_t index))
+         * @param segments Массив отрезков
+         * @param count Кол-во отрезков
+         * @param colorFn Функция цвета отрезка по индексу в массиве
+         */
+        template<typename COLOR_FN>
+        void drawImpl(const Segment* segments, size_t count, const COLOR_FN& colorFn)
+        {
+            if(count == 0 || pBuffer_->getWidth() == 0 || pBuffer_->getHeight() == 0) return;
+
+            // Без пула потоков - отсечение и растеризация по порядку, раскладка не нужна
+            if(pThreadPool_ == nullptr || pThreadPool_->getThreadCount() == 1)
+            {
+                const BBox2D<int> bounds = this->getBounds();
+                for(size_t i = 0; i < count; i++)
+                {
+                    const Segment& s = segments[i];
+                    SetLineClipped(pBuffer_, s.x0, s.y0, s.x1, s.y1, &bounds, colorFn(i));
+                }
+                return;
+            }
+
+            tilesX_ = (static_cast<int>(pBuffer_->getWidth()) + tileSize_ - 1) / tileSize_;
+            tilesY_ = (static_cast<int>(pBuffer_->getHeight()) + tileSize_ - 1) / tileSize_;
+            const size_t tileCount = static_cast<size_t>(tilesX_) * tilesY_;
+
+            for(size_t passBegin = 0; passBegin < count; passBegin += kMaxPassSize)
+            {
+                const size_t passSize = count - passBegin < kMaxPassSize ? count - passBegin : kMaxPassSize;
+                const Segment* passSegments = segments + passBegin;
+
+                // Части раскладки - непрерывные диапазоны отрезков (несколько на поток для балансировки)
+                const size_t chunkCount = std::max<size_t>(1, std::min<size_t>(pThreadPool_->getThreadCount() * 4, passSize / kMinChunkSize));
+                const size_t chunkSize = (passSize + chunkCount - 1) / chunkCount;
+                if(chunks_.size() < chunkCount) chunks_.resize(chunkCount);
+
+                pThreadPool_->parallelFor(chunkCount, [&](size_t c){
+                    this->binChunk(chunks_[c], passSegments, c * chunkSize, std::min(passSize, (c + 1) * chunkSize));
+                });
+
+                pThreadPool_->parallelFor(tileCount, [&](size_t tileIndex){
+                    this->rasterizeTile(tileIndex, chunkCount, passSegments, [&](size_t index){
+                        return colorFn(passBegin + index);
+                    });
+                });
+            }
+        }
+
+    public:
+        /**
+         * Конструктор
+         * @param pBuffer Указатель на буфер изображения
+         * @param pThreadPool Указатель на пул потоков (nullptr - растеризация в вызывающем потоке)
+         * @param tileSize Размер стороны тайла в пикселях (округляется вверх до кратного kLazyClearTileSize, чтобы потоки
+         * не выполняли отложенную очистку одних и тех же тайлов буфера)
+         */
+        explicit LineBatchRenderer(BUFFER* pBuffer, tools::ThreadPool* pThreadPool = nullptr, int tileSize = kDefaultLineTileSize):
+                pBuffer_(pBuffer),
+                pThreadPool_(pThreadPool),
+                tileSize_(((std::max(tileSize, 1) + kLazyClearTileSize - 1) / kLazyClearTileSize) * kLazyClearTileSize)
+        {}
+
+        /**
+         * Растеризовать массив отрезков одним цветом
+         * @param segments Массив отрезков
+         * @param count Кол-во отрезков
+         * @param color Цвет
+         */
+        void draw(const Segment* segments, size_t count, const ValueType& color)
+        {
+            this->drawImpl(segments, count, [&](size_t){ return color; });
+        }
+
+        /**
+         * Растеризовать массив отрезков, у каждого отрезка свой цвет
+         * @param segments Массив отрезков
+         * @param count Кол-во отрезков
+         * @param colors Массив цветов (по одному на отрезок)
+         */
+        void draw(const Segment* segments, size_t count, const ValueType* colors)
+        {
+            this->drawImpl(segments, count, [colors](size_t index){ return colors[index]; });
+        }
+    };
+
+    /**
+     * Растеризовать массив отрезков одним цветом (отсечение, раскладка по тайлам и параллельная растеризация)
+     * @details Для вызовов каждый кадр выгоднее LineBatchRenderer (память корзин переиспользуется)
+     * @tparam BUFFER Тип буфера изображения (ImageBuffer с любым расположением или ImageBufferView)
+     * @param imageBuffer Указатель на объект буфера изображения
+     * @param segments Массив отрезков
+     * @param count Кол-во отрезков
+     * @param color Цвет
+     * @param pThreadPool Указатель на пул потоков (nullptr - растеризация в вызывающем потоке)
+     * @param tileSize Размер стороны тайла в пикселях
+     */
+    template<typename BUFFER>
+    void DrawLines(BUFFER* imageBuffer,
+                   const Segment* segments, size_t count,
+                   const typename BUFFER::ValueType& color,
+                   tools::ThreadPool* pThreadPool = nullptr,
+                   int tileSize = kDefaultLineTileSize)
+    {
+        LineBatchRenderer<BUFFER>(imageBuffer, pThreadPool, tileSize).draw(segments, count, color);
+    }
+
+    /**
+     * Растеризовать массив отрезков, у каждого отрезка свой цвет (отсечение, раскладка по тайлам и параллельная растеризация)
+     * @tparam BUFFER Тип буфера изображения (ImageBuffer с любым расположением или ImageBufferView)
+     * @param imageBuffer Указатель на объект буфера изображения
+     * @param segments Массив отрезков
+     * @param count Кол-во отрезков
+     * @param colors Массив цветов (по одному на отрезок)
+     * @param pThreadPool Указатель на пул потоков (nullptr - растеризация в вызывающем потоке)
+     * @param tileSize Размер стороны тайла в пикселях
+     */
+    template<typename BUFFER>
+    void DrawLines(BUFFER* imageBuffer,
+                   const Segment* segments, size_t count,
+                   const typename BUFFER::ValueType* colors,
+                   tools::ThreadPool* pThreadPool = nullptr,
+                   int tileSize = kDefaultLineTileSize)
+    {
+        LineBatchRenderer<BUFFER>(imageBuffer, pThreadPool, tileSize).draw(segments, count, colors);
+    }
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define GFX_FILL_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GFX_FILL_SSE2
+#endif
+
+namespace gfx
+{
+    /// Размер блока, которым выполняется потоковая запись (размер кеш-линии)
+    constexpr size_t kStreamFillBlockSize = 64;
+
+    /// Размер области (в байтах), начиная с которого заполнение выполняется потоковой записью в обход кеша
+    constexpr size_t kStreamFillThreshold = 2u * 1024u * 1024u;
+
+    /**
+     * Доступна ли потоковая запись для элементов данного типа
+     * @details Требуется векторный набор инструкций и размер элемента, на который делится размер блока записи
+     * @tparam T Тип элемента
+     * @return Да или нет
+     */
+    template <typename T>
+    constexpr bool IsStreamFillSupported()
+    {
+#if defined(GFX_FILL_AVX) || defined(GFX_FILL_SSE2)
+        return kStreamFillBlockSize % sizeof(T) == 0;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * Заполнение массива значением с использованием потоковых (non-temporal) векторных записей
+     * @details Записи идут в обход кеша, поэтому заполнение больших областей не вытесняет из кеша полезные данные
+     * и не требует предварительного чтения кеш-линий. Начало и конец массива, не выровненные по kStreamFillBlockSize,
+     * заполняются обычным образом. Если потоковая запись недоступна (см. IsStreamFillSupported) - обычное заполнение.
+     * После заполнения выполняется барьер записи, т.е. данные видны другим потокам после синхронизации с ними.
+     * @tparam T Тип элемента
+     * @param data Указатель на массив
+     * @param count Кол-во элементов
+     * @param value Значение
+     */
+    template <typename T>
+    void StreamFill(T* data, size_t count, const T& value)
+    {
+#if defined(GFX_FILL_AVX) || defined(GFX_FILL_SSE2)
+        if(!IsStreamFillSupported<T>() || count * sizeof(T) < kStreamFillBlockSize * 2){
+            std::fill_n(data, count, value);
+            return;
+        }
+
+        // Элементы до первого выровненного адреса
+        auto address = reinterpret_cast<uintptr_t>(data);
+        size_t headBytes = (kStreamFillBlockSize - address % kStreamFillBlockSize) % kStreamFillBlockSize;
+        if(headBytes % sizeof(T) != 0){
+            // Массив не выровнен даже по размеру элемента - выровненного начала блока не достичь
+            std::fill_n(data, count, value);
+            return;
+        }
+
+        size_t head = headBytes / sizeof(T);
+        std::fill_n(data, head, value);
+
+        // Шаблон блока записи (значение, повторенное до размера блока)
+        alignas(kStreamFillBlockSize) unsigned char pattern[kStreamFillBlockSize];
+        for(size_t offset = 0; offset < kStreamFillBlockSize; offset += sizeof(T)){
+            memcpy(pattern + offset, &value, sizeof(T));
+        }
+
+        const size_t blockElements = kStreamFillBlockSize / sizeof(T);
+        size_t blocks = (count - head) / blockElements;
+        auto* dst = reinterpret_cast<unsigned char*>(data + head);
+
+#if defined(GFX_FILL_AVX)
+        const __m256i p0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(pattern));
+        const __m256i p1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(pattern + 32));
+        for(size_t i = 0; i < blocks; i++, dst += kStreamFillBlockSize){
+            _mm256_stream_si256(reinterpret_cast<__m256i*>(dst), p0);
+            _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + 32), p1);
+        }
+#else
+        const __m128i p0 = _mm_load_si128(reinterpret_cast<const __m128i*>(pattern));
+        const __m128i p1 = _mm_load_si128(reinterpret_cast<const __m128i*>(pattern + 16));
+        const __m128i p2 = _mm_load_si128(reinterpret_cast<const __m128i*>(pattern + 32));
+        const __m128i p3 = _mm_load_si128(reinterpret_cast<const __m128i*>(pattern + 48));
+        for(size_t i = 0; i < blocks; i++, dst += kStreamFillBlockSize){
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst), p0);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 16), p1);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 32), p2);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 48), p3);
+        }
+#endif
+        // Потоковые записи слабо упорядочены - завершить их до возврата
+        _mm_sfence();
+
+        // Оставшиеся элементы
+        size_t done = head + blocks * blockElements;
+        std::fill_n(data + done, count - done, value);
+#else
+        std::fill_n(data, count, value);
+#endif
+    }
+}
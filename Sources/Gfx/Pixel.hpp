@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+
+namespace gfx
+{
+    /**
+     * Пиксель в формате BGRA (8 бит на канал)
+     * @details Порядок байт совпадает с RGBQUAD (Win32) и 32-битными визуалами X11, поэтому буфер таких пикселей
+     * выводится без преобразования формата
+     */
+    struct PixelBGRA
+    {
+        uint8_t b;
+        uint8_t g;
+        uint8_t r;
+        uint8_t a;
+
+        bool operator==(const PixelBGRA& other) const
+        {
+            return b == other.b && g == other.g && r == other.r && a == other.a;
+        }
+
+        bool operator!=(const PixelBGRA& other) const
+        {
+            return !(*this == other);
+        }
+    };
+
+    static_assert(sizeof(PixelBGRA) == 4, "PixelBGRA must be 4 bytes");
+
+    /**
+     * Преобразование пикселей в RGBA8 и обратно (для вывода и сохранения кадров)
+     * @details Специализации определены для PixelBGRA и uint32_t (0xAARRGGBB). Для других типов пикселей
+     * (например RGBQUAD) специализация объявляется пользователем:
+     * static void ToRGBA8(const T& pixel, uint8_t* rgba) и static T FromRGBA8(const uint8_t* rgba)
+     * @tparam T Тип пикселя
+     */
+    template<typename T>
+    struct PixelTraits;
+
+    template<>
+    struct PixelTraits<PixelBGRA>
+    {
+        static void ToRGBA8(const PixelBGRA& pixel, uint8_t* rgba)
+        {
+            rgba[0] = pixel.r;
+            rgba[1] = pixel.g;
+            rgba[2] = pixel.b;
+            rgba[3] = pixel.a;
+        }
+
+        static PixelBGRA FromRGBA8(const uint8_t* rgba)
+        {
+            return {rgba[2], rgba[1], rgba[0], rgba[3]};
+        }
+    };
+
+    template<>
+    struct PixelTraits<uint32_t>
+    {
+        static void ToRGBA8(const uint32_t& pixel, uint8_t* rgba)
+        {
+            rgba[0] = static_cast<uint8_t>(pixel >> 16u);
+            rgba[1] = static_cast<uint8_t>(pixel >> 8u);
+            rgba[2] = static_cast<uint8_t>(pixel);
+            rgba[3] = static_cast<uint8_t>(pixel >> 24u);
+        }
+
+        static uint32_t FromRGBA8(const uint8_t* rgba)
+        {
+            return (static_cast<uint32_t>(rgba[3]) << 24u) |
+                   (static_cast<uint32_t>(rgba[0]) << 16u) |
+                   (static_cast<uint32_t>(rgba[1]) << 8u) |
+                   static_cast<uint32_t>(rgba[2]);
+        }
+    };
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <functional>
+
+#include "ImageBuffer.hpp"
+
+namespace gfx
+{
+    /**
+     * Платформо-независимый интерфейс вывода кадров
+     * @details Реализации выводят кадр в окно, в файл или никуда (HeadlessPresenter), поэтому код отрисовки не зависит
+     * от платформы. present вызывается из одного потока (например потока вывода SwapChain), но не обязательно из того,
+     * в котором объект был создан.
+     * @tparam T Тип пикселей
+     * @tparam LAYOUT Расположение пикселей в буфере кадра
+     * @tparam STORAGE Хранилище пикселей буфера кадра
+     */
+    template<typename T, typename LAYOUT = LinearLayout, typename STORAGE = HeapStorage>
+    class Presenter
+    {
+    public:
+        /// Тип буфера кадра
+        using Buffer = ImageBuffer<T, LAYOUT, STORAGE>;
+
+        virtual ~Presenter() = default;
+
+        /**
+         * Вывести кадр
+         * @param frame Буфер кадра
+         */
+        virtual void present(const Buffer& frame) = 0;
+
+        /**
+         * Может ли вывод продолжаться (например, не закрыто ли окно)
+         * @return Да или нет
+         */
+        [[nodiscard]] virtual bool isOpen() const
+        {
+            return true;
+        }
+    };
+
+    /**
+     * Получить функцию вывода для цепочки буферов (SwapChain), вызывающую presenter
+     * @tparam T Тип пикселей
+     * @tparam LAYOUT Расположение пикселей в буфере кадра
+     * @tparam STORAGE Хранилище пикселей буфера кадра
+     * @param presenter Объект вывода (должен существовать дольше цепочки буферов)
+     * @return Функция вывода
+     */
+    template<typename T, typename LAYOUT, typename STORAGE>
+    std::function<void(const ImageBuffer<T, LAYOUT, STORAGE>&)> MakePresentFn(Presenter<T, LAYOUT, STORAGE>& presenter)
+    {
+        return [&presenter](const ImageBuffer<T, LAYOUT, STORAGE>& frame){ presenter.present(frame); };
+    }
+}
@@ -1,17 +1,22 @@
 #pragma once
 
 #include "ImageBuffer.hpp"
+#include "Coverage.hpp"
 
 #include <functional>
+#include <algorithm>
 #include <vector>
+#include <cstdint>
+#include <cmath>
+#include <type_traits>
 
 namespace gfx
 {
-
-    template <typename VERTEX, typename COLOR, typename DEPTH>
-    class Rasterizer
+    /**
+     * Общие типы растеризатора (не зависят от параметров шаблона)
+     */
+    struct RasterizerTypes
     {
-    public:
         enum class FrontFace
         {
             eClockWise,
@@ -25,53 +30,741 @@ namespace gfx
             float z;
             float w;
         };
+    };
+
+    /**
+     * Проверка задан ли шейдер (для произвольного функтора - всегда задан)
+     * @tparam SHADER Тип функтора
+     * @return Да или нет
+     */
+    template <typename SHADER>
+    inline bool IsShaderBound(const SHADER&)
+    {
+        return true;
+    }
+
+    /**
+     * Проверка задан ли шейдер (для std::function - не пуста ли функция)
+     * @tparam SIGNATURE Сигнатура функции
+     * @param shader Функция
+     * @return Да или нет
+     */
+    template <typename SIGNATURE>
+    inline bool IsShaderBound(const std::function<SIGNATURE>& shader)
+    {
+        return static_cast<bool>(shader);
+    }
+
+    /**
+     * Растеризатор треугольников с программируемым шейдерным конвейером
+     * @details Конвейер: вершинный шейдер -> отсечение в клип-пространстве -> перспективное деление ->
+     * перевод в координаты экрана -> отбрасывание задних граней -> растеризация (с учетом правила "верхней-левой грани") ->
+     * тест глубины -> фрагментный шейдер (с перспективно-корректной интерполяцией вершин).
+     *
+     * Клип-пространство описывается как в D3D: -w <= x <= w, -w <= y <= w, 0 <= z <= w. Глубина фрагмента равна z/w
+     * и лежит в диапазоне [0;1] (меньшее значение - ближе к наблюдателю).
+     *
+     * Шейдеры задаются параметрами шаблона, благодаря чему их вызовы в цикле по фрагментам могут быть встроены компилятором.
+     * Для задания шейдеров во время исполнения используется Rasterizer (на основе std::function).
+     *
+     * @tparam VERTEX Тип вершины. Должен иметь конструктор по умолчанию, а также операторы "VERTEX + VERTEX" и "VERTEX * float"
+     * (используются при отсечении и интерполяции)
+     * @tparam COLOR Тип пикселей буфера цвета
+     * @tparam DEPTH Тип пикселей буфера глубины (должен быть приводим из float)
+     * @tparam VERTEX_SHADER Функтор вершинного шейдера с сигнатурой VERTEX(const VERTEX&, Vec4* outPosition)
+     * @tparam FRAGMENT_SHADER Функтор фрагментного шейдера с сигнатурой COLOR(const VERTEX&)
+     * @tparam COLOR_BUFFER Тип буфера цвета (ImageBuffer с любым расположением или ImageBufferView)
+     * @tparam DEPTH_BUFFER Тип буфера глубины (ImageBuffer с любым расположением или ImageBufferView)
+     */
+    template <typename VERTEX, typename COLOR, typename DEPTH, typename VERTEX_SHADER, typename FRAGMENT_SHADER,
+              typename COLOR_BUFFER = ImageBuffer<COLOR>, typename DEPTH_BUFFER = ImageBuffer<DEPTH>>
+    class BasicRasterizer : public RasterizerTypes
+    {
+        static_assert(std::is_same<typename COLOR_BUFFER::ValueType, COLOR>::value, "Color buffer element type must match COLOR");
+        static_assert(std::is_same<typename DEPTH_BUFFER::ValueType, DEPTH>::value, "Depth buffer element type must match DEPTH");
+
+    protected:
+        /// Кол-во бит дробной части координат экрана (точность под-пикселя)
+        static constexpr int kSubPixelBits = 4;
+        /// Размер пикселя в единицах под-пикселя
+        static constexpr int kSubPixelStep = 1 << kSubPixelBits;
+        /// Максимальное кол-во вершин полигона после отсечения треугольника 6-ю плоскостями
+        static constexpr int kMaxClippedVertices = 9;
+        /// Бит маски отсечения для вершин с w <= kMinClipW (плоскостью не отсекается - такие полигоны отбрасываются)
+        static constexpr unsigned kDegenerateWBit = 1u << 6u;
+        /// Минимальное значение w вершины, для которой выполняется перспективное деление
+        static constexpr float kMinClipW = 1e-5f;
+
+        /**
+         * Прямоугольная область буфера, за пределы которой растеризация не выходит (границы включительно)
+         */
+        struct ScissorRect
+        {
+            int minX;
+            int minY;
+            int maxX;
+            int maxY;
+        };
+
+        /**
+         * Вершина участвующая в отсечении (положение в клип-пространстве и выходные данные вершинного шейдера)
+         */
+        struct ClipVertex
+        {
+            Vec4 position;
+            VERTEX vertex;
+        };
+
+        /**
+         * Вершина в пространстве экрана (после перспективного деления)
+         */
+        struct ScreenVertex
+        {
+            /// Координаты в единицах под-пикселя
+            int64_t x;
+            int64_t y;
+            /// Глубина (z/w)
+            float z;
+            /// Обратное значение w (для перспективно-корректной интерполяции)
+            float invW;
+        };
+
+        /**
+         * Обработанная вершинным шейдером вершина (элемент кеша пост-трансформации)
+         */
+        struct TransformedVertex
+        {
+            /// Положение в клип-пространстве и выходные данные шейдера
+            ClipVertex clip;
+            /// Положение в пространстве экрана (имеет смысл только если вершина не требует отсечения)
+            ScreenVertex screen;
+            /// Маска плоскостей отсечения, за которыми находится вершина
+            unsigned outCode;
+        };
 
-    private:
         /// Указатель на буфер цвета
-        ImageBuffer<COLOR>* pColorBuffer_;
+        COLOR_BUFFER* pColorBuffer_;
         /// Указатель на буфер глубины
-        ImageBuffer<DEPTH>* pDepthBuffer_;
+        DEPTH_BUFFER* pDepthBuffer_;
         /// Как описывается передняя грань
         FrontFace frontFace_;
         /// Отсечение задних граней
         bool backFaceCooling_;
 
-        /// Функция - вершинный шейдер
-        std::function<VERTEX(const VERTEX& vertex, Vec4* outPosition)> vertexShaderFn_;
+        /// Кеш пост-трансформации для индексированной отрисовки (обработанные вершины)
+        std::vector<TransformedVertex> vertexCache_;
+        /// Метки кеша (номер вызова отрисовки, в котором вершина была обработана)
+        std::vector<uint32_t> vertexCacheTags_;
+        /// Номер текущего вызова индексированной отрисовки
+        uint32_t drawCallIndex_ = 0;
+
+        /// Функтор - вершинный шейдер
+        VERTEX_SHADER vertexShaderFn_;
+
+        /// Функтор - фрагментный шейдер
+        FRAGMENT_SHADER fragmentShaderFn_;
+
+        /**
+         * Расстояние до плоскости отсечения (неотрицательное значение - точка внутри)
+         * @param p Положение в клип-пространстве
+         * @param plane Номер плоскости
+         * @return Значение
+         */
+        static float PlaneDistance(const Vec4& p, int plane)
+        {
+            switch (plane)
+            {
+                case 0: return p.w + p.x;
+                case 1: return p.w - p.x;
+                case 2: return p.w + p.y;
+                case 3: return p.w - p.y;
+                case 4: return p.z;
+                default: return p.w - p.z;
+            }
+        }
+
+        /**
+         * Битовая маска плоскостей, за которыми находится точка
+         * @details Точка с w <= kMinClipW проходит все плоскости (например (0,0,0,0)), но перспективное деление для нее
+         * не определено - она помечается битом kDegenerateWBit
+         * @param p Положение в клип-пространстве
+         * @return Маска
+         */
+        static unsigned OutCode(const Vec4& p)
+        {
+            unsigned code = 0;
+            for(int plane = 0; plane < 6; plane++){
+                if(PlaneDistance(p, plane) < 0.0f) code |= (1u << static_cast<unsigned>(plane));
+            }
+            if(!(p.w > kMinClipW)) code |= kDegenerateWBit;
+            return code;
+        }
+
+        /**
+         * Интерполяция вершины отсечения
+         * @param a Первая вершина
+         * @param b Вторая вершина
+         * @param t Коэффициент (0 - первая, 1 - вторая)
+         * @return Новая вершина
+         */
+        static ClipVertex Lerp(const ClipVertex& a, const ClipVertex& b, float t)
+        {
+            ClipVertex result;
+            result.position = {
+                    a.position.x + (b.position.x - a.position.x) * t,
+                    a.position.y + (b.position.y - a.position.y) * t,
+                    a.position.z + (b.position.z - a.position.z) * t,
+                    a.position.w + (b.position.w - a.position.w) * t
+            };
+            result.vertex = a.vertex * (1.0f - t) + b.vertex * t;
+            return result;
+        }
+
+        /**
+         * Отсечение полигона плоскостями клип-пространства (алгоритм Сазерленда-Ходжмана)
+         * @param polygon Массив вершин полигона (вход и выход)
+         * @param count Кол-во вершин полигона
+         * @param planes Маска плоскостей, которыми нужно отсекать
+         * @return Кол-во вершин полученного полигона
+         */
+        static int ClipPolygon(ClipVertex* polygon, int count, unsigned planes)
+        {
+            ClipVertex temp[kMaxClippedVertices];
+
+            for(int plane = 0; plane < 6 && count > 0; plane++)
+            {
+                if(!(planes & (1u << static_cast<unsigned>(plane)))) continue;
+
+                int outCount = 0;
+                for(int i = 0; i < count; i++)
+                {
+                    const ClipVertex& current = polygon[i];
+                    const ClipVertex& next = polygon[(i + 1) % count];
+                    float dCurrent = PlaneDistance(current.position, plane);
+                    float dNext = PlaneDistance(next.position, plane);
+
+                    if(dCurrent >= 0.0f) temp[outCount++] = current;
+                    if((dCurrent >= 0.0f) != (dNext >= 0.0f)){
+                        temp[outCount++] = Lerp(current, next, dCurrent / (dCurrent - dNext));
+                    }
+                }
+
+                count = outCount;
+                for(int i = 0; i < count; i++) polygon[i] = temp[i];
+            }
+
+            return count;
+        }
+
+        /**
+         * Перевод из клип-пространства в координаты экрана
+         * @param p Положение в клип-пространстве
+         * @return Вершина в пространстве экрана
+         */
+        ScreenVertex ToScreen(const Vec4& p) const
+        {
+            float invW = 1.0f / p.w;
+            float width = static_cast<float>(pColorBuffer_->getWidth());
+            float height = static_cast<float>(pColorBuffer_->getHeight());
+
+            ScreenVertex result;
+            result.x = static_cast<int64_t>(std::lround(((p.x * invW + 1.0f) * 0.5f * width) * kSubPixelStep));
+            result.y = static_cast<int64_t>(std::lround(((1.0f - p.y * invW) * 0.5f * height) * kSubPixelStep));
+            result.z = p.z * invW;
+            result.invW = invW;
+            return result;
+        }
+
+        /**
+         * Удвоенная ориентированная площадь треугольника в пространстве экрана
+         * @details Положительна для обхода по часовой стрелке на экране (ось Y направлена вниз)
+         * @param s Указатели на вершины в пространстве экрана
+         * @return Значение площади
+         */
+        static int64_t SignedArea(const ScreenVertex* const* s)
+        {
+            return (s[1]->x - s[0]->x) * (s[2]->y - s[0]->y) - (s[2]->x - s[0]->x) * (s[1]->y - s[0]->y);
+        }
+
+        /**
+         * Проверка вырожденности треугольника и отбрасывание задних граней
+         * @param area Удвоенная ориентированная площадь треугольника
+         * @return Нужно ли растеризовать треугольник
+         */
+        bool IsVisible(int64_t area) const
+        {
+            if(area == 0) return false;
+
+            bool clockWise = area > 0;
+            bool frontFacing = (frontFace_ == FrontFace::eClockWise) == clockWise;
+            return !backFaceCooling_ || frontFacing;
+        }
+
+        /**
+         * Область растеризации совпадающая со всем буфером цвета
+         * @return Прямоугольник
+         */
+        ScissorRect FullScissor() const
+        {
+            return {0, 0, static_cast<int>(pColorBuffer_->getWidth()) - 1, static_cast<int>(pColorBuffer_->getHeight()) - 1};
+        }
+
+        /**
+         * Растеризация треугольника в пространстве экрана
+         * @param s Указатели на вершины в пространстве экрана
+         * @param v Указатели на выходные данные вершинного шейдера
+         * @param scissor Область буфера, которой ограничивается растеризация
+         */
+        void RasterizeScreenTriangle(const ScreenVertex* const* s, const VERTEX* const* v, const ScissorRect& scissor)
+        {
+            // Удвоенная ориентированная площадь (положительна для обхода по часовой стрелке на экране, ось Y направлена вниз)
+            int64_t area = SignedArea(s);
+            if(!IsVisible(area)) return;
+            bool clockWise = area > 0;
+
+            // Привести треугольник к обходу по часовой стрелке (индексы вершин в порядке обхода)
+            int i0 = 0, i1 = 1, i2 = 2;
+            if(!clockWise){
+                std::swap(i1, i2);
+                area = -area;
+            }
+
+            const ScreenVertex& a = *s[i0];
+            const ScreenVertex& b = *s[i1];
+            const ScreenVertex& c = *s[i2];
+
+            // Описывающий прямоугольник (в пикселях), ограниченный областью растеризации
+            int64_t minX = std::min(a.x, std::min(b.x, c.x)) >> kSubPixelBits;
+            int64_t minY = std::min(a.y, std::min(b.y, c.y)) >> kSubPixelBits;
+            int64_t maxX = std::max(a.x, std::max(b.x, c.x)) >> kSubPixelBits;
+            int64_t maxY = std::max(a.y, std::max(b.y, c.y)) >> kSubPixelBits;
+            minX = std::max<int64_t>(minX, scissor.minX);
+            minY = std::max<int64_t>(minY, scissor.minY);
+            maxX = std::min<int64_t>(maxX, scissor.maxX);
+            maxY = std::min<int64_t>(maxY, scissor.maxY);
+            if(minX > maxX || minY > maxY) return;
+
+            // Уравнения граней E(p) = dx * (p.y - from.y) - dy * (p.x - from.x) для центров пикселей (в виде a*x + b*y + c)
+            // Грань напротив вершины k дает барицентрический вес этой вершины
+            const ScreenVertex* from[3] = {&b, &c, &a};
+            const ScreenVertex* to[3] = {&c, &a, &b};
+            EdgeEquation edges[3];
+            int64_t bias[3];
+
+            for(int e = 0; e < 3; e++)
+            {
+                int64_t dx = to[e]->x - from[e]->x;
+                int64_t dy = to[e]->y - from[e]->y;
+
+                // Правило верхней-левой грани: точки лежащие на верхних и левых гранях принадлежат треугольнику,
+                // для остальных граней значение уравнения смещается на единицу (проверка становится строгой)
+                bool topLeft = (dy < 0) || (dy == 0 && dx > 0);
+                bias[e] = topLeft ? 0 : 1;
+
+                edges[e].a = -dy * kSubPixelStep;
+                edges[e].b = dx * kSubPixelStep;
+                edges[e].c = dx * (kSubPixelStep / 2 - from[e]->y) - dy * (kSubPixelStep / 2 - from[e]->x) - bias[e];
+            }
+
+            double invArea = 1.0 / static_cast<double>(area);
+
+            // Приращения барицентрических координат при сдвиге на пиксель
+            float stepX0 = static_cast<float>(static_cast<double>(edges[0].a) * invArea);
+            float stepY0 = static_cast<float>(static_cast<double>(edges[0].b) * invArea);
+            float stepX1 = static_cast<float>(static_cast<double>(edges[1].a) * invArea);
+            float stepY1 = static_cast<float>(static_cast<double>(edges[1].b) * invArea);
+
+            // Обход блоками 8x8 (полностью закрытые и пустые блоки определяются без попиксельной проверки)
+            RasterizeCoverageBlocks(edges, static_cast<int>(minX), static_cast<int>(minY), static_cast<int>(maxX), static_cast<int>(maxY),
+                    [&](int bx, int by, uint64_t mask)
+            {
+                // Отложенная очистка затрагиваемой блоком области буферов (блок не выходит за тайл отложенной очистки)
+                pColorBuffer_->resolveRect(bx, by, bx + kCoverageBlockSize - 1, by + kCoverageBlockSize - 1);
+                if(pDepthBuffer_ != nullptr) pDepthBuffer_->resolveRect(bx, by, bx + kCoverageBlockSize - 1, by + kCoverageBlockSize - 1);
+
+                // Барицентрические координаты в левом верхнем пикселе блока (точно, через целые значения уравнений)
+                float origin0 = static_cast<float>(static_cast<double>(edges[0].a * bx + edges[0].b * by + edges[0].c + bias[0]) * invArea);
+                float origin1 = static_cast<float>(static_cast<double>(edges[1].a * bx + edges[1].b * by + edges[1].c + bias[1]) * invArea);
+
+                for(int row = 0; row < kCoverageBlockSize; row++)
+                {
+                    auto bits = static_cast<uint32_t>(mask >> static_cast<unsigned>(row * kCoverageBlockSize)) & 0xFFu;
+                    if(bits == 0) continue;
+
+                    int y = by + row;
+                    auto line = (*pColorBuffer_)[y];
+
+                    for(int col = 0; col < kCoverageBlockSize; col++)
+                    {
+                        if(!(bits & (1u << static_cast<unsigned>(col)))) continue;
+
+                        // Барицентрические координаты в пространстве экрана
+                        float b0 = origin0 + stepX0 * static_cast<float>(col) + stepY0 * static_cast<float>(row);
+                        float b1 = origin1 + stepX1 * static_cast<float>(col) + stepY1 * static_cast<float>(row);
+                        float b2 = 1.0f - b0 - b1;
+
+                        // Глубина интерполируется линейно в пространстве экрана
+                        float depth = a.z * b0 + b.z * b1 + c.z * b2;
+
+                        int x = bx + col;
+                        if(!this->depthTest(x, y, depth)) continue;
+
+                        // Перспективно-корректные веса
+                        float p0 = b0 * a.invW;
+                        float p1 = b1 * b.invW;
+                        float p2 = b2 * c.invW;
+                        float invSum = 1.0f / (p0 + p1 + p2);
+
+                        VERTEX interpolated = (*v[i0]) * (p0 * invSum) + (*v[i1]) * (p1 * invSum) + (*v[i2]) * (p2 * invSum);
+                        line[x] = fragmentShaderFn_(interpolated);
+                    }
+                }
+            });
+        }
+
+        /**
+         * Тест глубины (с записью нового значения в случае успеха)
+         * @param x Координаты пикселя по X
+         * @param y Координаты пикселя по Y
+         * @param depth Глубина фрагмента
+         * @return Прошел ли фрагмент тест
+         */
+        bool depthTest(int x, int y, float depth)
+        {
+            if(pDepthBuffer_ == nullptr) return true;
+
+            // Чтение через константный доступ - разреженный буфер выделяет тайл только при записи прошедшего фрагмента
+            const DEPTH_BUFFER& depthSource = *pDepthBuffer_;
+            if(!(static_cast<DEPTH>(depth) < depthSource[y][x])) return false;
+
+            (*pDepthBuffer_)[y][x] = static_cast<DEPTH>(depth);
+            return true;
+        }
 
-        /// Функция - фрагментный шейдер
-        std::function<COLOR(const VERTEX& interpolatedVertexInfo)> fragmentShaderFn_;
     public:
         /**
          * Конструктор по умолчанию
          */
-        Rasterizer():
+        BasicRasterizer():
                 pColorBuffer_(nullptr),
                 pDepthBuffer_(nullptr),
                 frontFace_(FrontFace::eClockWise),
-                backFaceCooling_(true)
+                backFaceCooling_(true),
+                vertexShaderFn_(),
+                fragmentShaderFn_()
         {}
 
         /**
          * Основной конструктор
          * @param pColorBuffer Указатель на буфер цвета
          * @param pDepthBuffer Указатель на буфер глубины
+         * @param vertexShaderFn Функтор вершинного шейдера
+         * @param fragmentShaderFn Функтор фрагментного шейдера
          * @param frontFace Как описывается передняя грань
          * @param backFaceCooling Отсечение задних граней
          */
-        Rasterizer(ImageBuffer<COLOR>* pColorBuffer,
-                   ImageBuffer<DEPTH>* pDepthBuffer,
-                   FrontFace frontFace = FrontFace::eClockWise,
-                   bool backFaceCooling = true):
+        BasicRasterizer(COLOR_BUFFER* pColorBuffer,
+                        DEPTH_BUFFER* pDepthBuffer,
+                        VERTEX_SHADER vertexShaderFn,
+                        FRAGMENT_SHADER fragmentShaderFn,
+                        FrontFace frontFace = FrontFace::eClockWise,
+                        bool backFaceCooling = true):
                 pColorBuffer_(pColorBuffer),
                 pDepthBuffer_(pDepthBuffer),
                 frontFace_(frontFace),
-                backFaceCooling_(backFaceCooling)
+                backFaceCooling_(backFaceCooling),
+                vertexShaderFn_(std::move(vertexShaderFn)),
+                fragmentShaderFn_(std::move(fragmentShaderFn))
         {}
 
+        /**
+         * Установить буфер цвета
+         * @param pColorBuffer Указатель на буфер цвета
+         */
+        void setColorBuffer(COLOR_BUFFER* pColorBuffer)
+        {
+            pColorBuffer_ = pColorBuffer;
+        }
+
+        /**
+         * Установить буфер глубины
+         * @param pDepthBuffer Указатель на буфер глубины (nullptr - тест глубины отключен)
+         */
+        void setDepthBuffer(DEPTH_BUFFER* pDepthBuffer)
+        {
+            pDepthBuffer_ = pDepthBuffer;
+        }
+
+    protected:
+        /**
+         * Обработка вершины вершинным шейдером
+         * @param vertex Исходная вершина
+         * @param out Обработанная вершина
+         */
+        void TransformVertex(const VERTEX& vertex, TransformedVertex* out)
+        {
+            out->clip.vertex = vertexShaderFn_(vertex, &out->clip.position);
+            out->outCode = OutCode(out->clip.position);
+            if(out->outCode == 0) out->screen = ToScreen(out->clip.position);
+        }
+
+        /**
+         * Отсечение треугольника из обработанных вершин и передача результата на растеризацию
+         * @tparam EMIT Функтор принимающий треугольник в пространстве экрана (const ScreenVertex* const*, const VERTEX* const*)
+         * @param t Указатели на три обработанные вершины
+         * @param emit Функтор получающий треугольники готовые к растеризации
+         */
+        template <typename EMIT>
+        void ProcessTriangle(const TransformedVertex* const* t, EMIT&& emit)
+        {
+            unsigned c0 = t[0]->outCode;
+            unsigned c1 = t[1]->outCode;
+            unsigned c2 = t[2]->outCode;
+
+            // Если все вершины за одной и той же плоскостью - треугольник не виден
+            if(c0 & c1 & c2) return;
+
+            // Треугольник целиком внутри - координаты экрана уже вычислены
+            if((c0 | c1 | c2) == 0){
+                const ScreenVertex* s[3] = {&t[0]->screen, &t[1]->screen, &t[2]->screen};
+                const VERTEX* v[3] = {&t[0]->clip.vertex, &t[1]->clip.vertex, &t[2]->clip.vertex};
+                emit(s, v);
+                return;
+            }
+
+            // Отсечение
+            ClipVertex polygon[kMaxClippedVertices];
+            polygon[0] = t[0]->clip;
+            polygon[1] = t[1]->clip;
+            polygon[2] = t[2]->clip;
+
+            int count = ClipPolygon(polygon, 3, c0 | c1 | c2);
+            if(count < 3) return;
+
+            // Перспективное деление и перевод в координаты экрана (полигон, касающийся точки w = 0, вырожден на экране)
+            ScreenVertex screen[kMaxClippedVertices];
+            for(int i = 0; i < count; i++){
+                if(!(polygon[i].position.w > kMinClipW)) return;
+                screen[i] = ToScreen(polygon[i].position);
+            }
+
+            // Полигон разбивается на треугольники веером
+            for(int i = 1; i + 1 < count; i++)
+            {
+                const ScreenVertex* s[3] = {&screen[0], &screen[i], &screen[i + 1]};
+                const VERTEX* v[3] = {&polygon[0].vertex, &polygon[i].vertex, &polygon[i + 1].vertex};
+                emit(s, v);
+            }
+        }
+
+        /**
+         * Готов ли растеризатор к отрисовке (заданы буферы и шейдеры)
+         * @details Область растеризации задается буфером цвета, поэтому буфер глубины (если задан) должен быть не меньше его
+         * @return Да или нет
+         */
+        bool isReady() const
+        {
+            if(pColorBuffer_ == nullptr || pColorBuffer_->getWidth() == 0 || pColorBuffer_->getHeight() == 0) return false;
+            if(pDepthBuffer_ != nullptr && (pDepthBuffer_->getWidth() < pColorBuffer_->getWidth() ||
+                                            pDepthBuffer_->getHeight() < pColorBuffer_->getHeight())) return false;
+            return IsShaderBound(vertexShaderFn_) && IsShaderBound(fragmentShaderFn_);
+        }
+
+        /**
+         * Обработка треугольника (вершинный шейдер и отсечение)
+         * @param v0 Первая вершина
+         * @param v1 Вторая вершина
+         * @param v2 Третья вершина
+         * @param emit Функтор получающий треугольники готовые к растеризации
+         */
+        template <typename EMIT>
+        void TransformTriangle(const VERTEX& v0, const VERTEX& v1, const VERTEX& v2, EMIT&& emit)
+        {
+            TransformedVertex transformed[3];
+            TransformVertex(v0, &transformed[0]);
+            TransformVertex(v1, &transformed[1]);
+            TransformVertex(v2, &transformed[2]);
+
+            const TransformedVertex* t[3] = {&transformed[0], &transformed[1], &transformed[2]};
+            ProcessTriangle(t, emit);
+        }
+
+        /**
+         * Обработка индексированного списка треугольников
+         * @details Каждая вершина, на которую ссылаются индексы, обрабатывается вершинным шейдером только один раз за вызов,
+         * результат переиспользуется всеми треугольниками через кеш пост-трансформации. Тройки индексов с выходом
+         * за пределы массива вершин пропускаются.
+         * @param vertices Массив вершин
+         * @param count Кол-во вершин
+         * @param indices Массив индексов (по три на треугольник)
+         * @param indexCount Кол-во индексов
+         * @param emit Функтор получающий треугольники готовые к растеризации
+         */
+        template <typename EMIT>
+        void TransformIndexed(const VERTEX* vertices, size_t count, const uint32_t* indices, size_t indexCount, EMIT&& emit)
+        {
+            if(!isReady() || vertices == nullptr || indices == nullptr || count == 0) return;
+
+            // Подготовить кеш (метки не очищаются - достаточно сменить номер вызова)
+            if(vertexCache_.size() < count){
+                vertexCache_.resize(count);
+                vertexCacheTags_.resize(count, drawCallIndex_);
+            }
+
+            if(++drawCallIndex_ == 0){
+                std::fill(vertexCacheTags_.begin(), vertexCacheTags_.end(), 0);
+                drawCallIndex_ = 1;
+            }
+
+            for(size_t i = 0; i + 3 <= indexCount; i += 3)
+            {
+                const TransformedVertex* t[3];
+                bool valid = true;
+
+                for(size_t j = 0; j < 3; j++)
+                {
+                    uint32_t index = indices[i + j];
+                    if(index >= count){
+                        valid = false;
+                        break;
+                    }
+
+                    // Промах кеша - обработать вершину шейдером
+                    if(vertexCacheTags_[index] != drawCallIndex_){
+                        TransformVertex(vertices[index], &vertexCache_[index]);
+                        vertexCacheTags_[index] = drawCallIndex_;
+                    }
+
+                    t[j] = &vertexCache_[index];
+                }
+
+                if(valid) ProcessTriangle(t, emit);
+            }
+        }
+
+    public:
+        /**
+         * Нарисовать треугольник
+         * @param v0 Первая вершина
+         * @param v1 Вторая вершина
+         * @param v2 Третья вершина
+         */
         void DrawTriangle(const VERTEX& v0, const VERTEX& v1, const VERTEX& v2)
         {
+            if(!isReady()) return;
+
+            ScissorRect scissor = FullScissor();
+            TransformTriangle(v0, v1, v2, [&](const ScreenVertex* const* s, const VERTEX* const* v){
+                RasterizeScreenTriangle(s, v, scissor);
+            });
+        }
+
+        /**
+         * Нарисовать индексированный список треугольников
+         * @details Каждая вершина, на которую ссылаются индексы, обрабатывается вершинным шейдером только один раз за вызов,
+         * результат переиспользуется всеми треугольниками через кеш пост-трансформации. Тройки индексов с выходом
+         * за пределы массива вершин пропускаются.
+         * @param vertices Массив вершин
+         * @param count Кол-во вершин
+         * @param indices Массив индексов (по три на треугольник)
+         * @param indexCount Кол-во индексов
+         */
+        void DrawIndexed(const VERTEX* vertices, size_t count, const uint32_t* indices, size_t indexCount)
+        {
+            if(!isReady()) return;
+
+            ScissorRect scissor = FullScissor();
+            TransformIndexed(vertices, count, indices, indexCount, [&](const ScreenVertex* const* s, const VERTEX* const* v){
+                RasterizeScreenTriangle(s, v, scissor);
+            });
         }
     };
-}
 
+    /**
+     * Растеризатор с шейдерами задаваемыми во время исполнения (через std::function)
+     * @details Более гибкий, но более медленный вариант (косвенный вызов на каждую вершину и каждый фрагмент)
+     * @tparam VERTEX Тип вершины
+     * @tparam COLOR Тип пикселей буфера цвета
+     * @tparam DEPTH Тип пикселей буфера глубины
+     */
+    template <typename VERTEX, typename COLOR, typename DEPTH>
+    class Rasterizer : public BasicRasterizer<VERTEX, COLOR, DEPTH,
+            std::function<VERTEX(const VERTEX& vertex, RasterizerTypes::Vec4* outPosition)>,
+            std::function<COLOR(const VERTEX& interpolatedVertexInfo)>>
+    {
+    public:
+        using Vec4 = RasterizerTypes::Vec4;
+        using FrontFace = RasterizerTypes::FrontFace;
+        using VertexShaderFn = std::function<VERTEX(const VERTEX& vertex, Vec4* outPosition)>;
+        using FragmentShaderFn = std::function<COLOR(const VERTEX& interpolatedVertexInfo)>;
+
+        /**
+         * Конструктор по умолчанию
+         */
+        Rasterizer() = default;
+
+        /**
+         * Основной конструктор
+         * @param pColorBuffer Указатель на буфер цвета
+         * @param pDepthBuffer Указатель на буфер глубины
+         * @param frontFace Как описывается передняя грань
+         * @param backFaceCooling Отсечение задних граней
+         */
+        Rasterizer(ImageBuffer<COLOR>* pColorBuffer,
+                   ImageBuffer<DEPTH>* pDepthBuffer,
+                   FrontFace frontFace = FrontFace::eClockWise,
+                   bool backFaceCooling = true):
+                BasicRasterizer<VERTEX, COLOR, DEPTH, VertexShaderFn, FragmentShaderFn>(
+                        pColorBuffer, pDepthBuffer, VertexShaderFn(), FragmentShaderFn(), frontFace, backFaceCooling)
+        {}
+
+        /**
+         * Установить вершинный шейдер
+         * @param vertexShaderFn Функция вершинного шейдера (возвращает данные для интерполяции, пишет положение в клип-пространстве)
+         */
+        void setVertexShader(VertexShaderFn vertexShaderFn)
+        {
+            this->vertexShaderFn_ = std::move(vertexShaderFn);
+        }
+
+        /**
+         * Установить фрагментный шейдер
+         * @param fragmentShaderFn Функция фрагментного шейдера (возвращает цвет фрагмента)
+         */
+        void setFragmentShader(FragmentShaderFn fragmentShaderFn)
+        {
+            this->fragmentShaderFn_ = std::move(fragmentShaderFn);
+        }
+    };
+
+    /**
+     * Создать растеризатор с шейдерами, привязанными на этапе компиляции
+     * @tparam VERTEX Тип вершины
+     * @tparam COLOR Тип пикселей буфера цвета
+     * @tparam DEPTH Тип пикселей буфера глубины
+     * @tparam VERTEX_SHADER Тип функтора вершинного шейдера (выводится)
+     * @tparam FRAGMENT_SHADER Тип функтора фрагментного шейдера (выводится)
+     * @tparam COLOR_BUFFER Тип буфера цвета (выводится)
+     * @tparam DEPTH_BUFFER Тип буфера глубины (выводится)
+     * @param pColorBuffer Указатель на буфер цвета
+     * @param pDepthBuffer Указатель на буфер глубины
+     * @param vertexShaderFn Функтор вершинного шейдера (например лямбда)
+     * @param fragmentShaderFn Функтор фрагментного шейдера (например лямбда)
+     * @param frontFace Как описывается передняя грань
+     * @param backFaceCooling Отсечение задних граней
+     * @return Объект растеризатора
+     */
+    template <typename VERTEX, typename COLOR, typename DEPTH, typename VERTEX_SHADER, typename FRAGMENT_SHADER,
+              typename COLOR_BUFFER, typename DEPTH_BUFFER>
+    BasicRasterizer<VERTEX, COLOR, DEPTH, VERTEX_SHADER, FRAGMENT_SHADER, COLOR_BUFFER, DEPTH_BUFFER> MakeRasterizer(
+            COLOR_BUFFER* pColorBuffer,
+            DEPTH_BUFFER* pDepthBuffer,
+            VERTEX_SHADER vertexShaderFn,
+            FRAGMENT_SHADER fragmentShaderFn,
+            RasterizerTypes::FrontFace frontFace = RasterizerTypes::FrontFace::eClockWise,
+            bool backFaceCooling = true)
+    {
+        return BasicRasterizer<VERTEX, COLOR, DEPTH, VERTEX_SHADER, FRAGMENT_SHADER, COLOR_BUFFER, DEPTH_BUFFER>(
+                pColorBuffer, pDepthBuffer, std::move(vertexShaderFn), std::move(fragmentShaderFn), frontFace, backFaceCooling);
+    }
+}
@@ -0,0 +1,532 @@
+#pragma once
+
+#if defined(__linux__)
+
+#include <atomic>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <climits>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <ctime>
+
+#include "Presenter.hpp"
+#include "ImageBufferView.hpp"
+
+namespace gfx
+{
+    /// Сигнатура заголовка кольца кадров ("GFXR")
+    constexpr uint32_t kSharedFrameRingMagic = 0x52584647u;
+    /// Версия формата кольца кадров
+    constexpr uint32_t kSharedFrameRingVersion = 1;
+
+    /**
+     * Заголовок кольца кадров в разделяемой памяти
+     * @details Атомарные поля используются из разных процессов, поэтому должны быть lock-free
+     */
+    struct SharedFrameRingHeader
+    {
+        /// Сигнатура (записывается последней, после заполнения заголовка)
+        std::atomic<uint32_t> magic;
+        uint32_t version;
+        /// Ширина кадров
+        uint32_t width;
+        /// Высота кадров
+        uint32_t height;
+        /// Длина строки в элементах
+        uint32_t pitch;
+        /// Размер пикселя в байтах
+        uint32_t pixelSize;
+        /// Кол-во слотов
+        uint32_t slotCount;
+        uint32_t reserved;
+        /// Смещение первого слота от начала памяти
+        uint64_t slotOffset;
+        /// Расстояние между слотами в байтах
+        uint64_t slotStride;
+
+        /// Номер последнего опубликованного кадра (кадры нумеруются с 1, 0 - кадров еще не было)
+        std::atomic<uint64_t> writeSequence;
+        /// Номер последнего кадра, прочитанного основным читателем
+        std::atomic<uint64_t> readSequence;
+        /// Кол-во кадров, перезаписанных до прочтения
+        std::atomic<uint64_t> droppedCount;
+        /// Слово ожидания (младшие 32 бита номера кадра, futex)
+        std::atomic<uint32_t> futexWord;
+        /// Кол-во ожидающих читателей (пробуждение без системного вызова, если никто не ждет)
+        std::atomic<uint32_t> waiters;
+    };
+
+    /**
+     * Заголовок слота кольца кадров
+     * @details sequence - счетчик последовательной блокировки (seqlock): нечетное значение 2N-1 - идет запись кадра N,
+     * четное 2N - слот содержит кадр N
+     */
+    struct alignas(64) SharedFrameSlotHeader
+    {
+        std::atomic<uint64_t> sequence;
+    };
+
+    static_assert((sizeof(long) == 8 ? ATOMIC_LONG_LOCK_FREE : ATOMIC_LLONG_LOCK_FREE) == 2 && ATOMIC_INT_LOCK_FREE == 2,
+                  "Shared frame ring requires lock-free atomics");
+    static_assert(std::is_standard_layout<SharedFrameRingHeader>::value, "Shared frame ring header must be standard layout");
+
+    namespace detail
+    {
+        /**
+         * Отображение именованного объекта разделяемой памяти (/dev/shm)
+         */
+        class SharedMapping
+        {
+        private:
+            void* data_ = nullptr;
+            size_t size_ = 0;
+
+        public:
+            SharedMapping() = default;
+            SharedMapping(const SharedMapping&) = delete;
+            SharedMapping& operator=(const SharedMapping&) = delete;
+
+            ~SharedMapping()
+            {
+                this->unmap();
+            }
+
+            /**
+             * Отобразить объект в память
+             * @param fd Дескриптор объекта
+             * @param size Размер в байтах
+             */
+            void map(int fd, size_t size)
+            {
+                this->unmap();
+                void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                if(ptr == MAP_FAILED) throw std::system_error(errno, std::generic_category(), "Unable to map shared frame ring");
+                data_ = ptr;
+                size_ = size;
+            }
+
+            /**
+             * Снять отображение
+             */
+            void unmap()
+            {
+                if(data_ != nullptr) munmap(data_, size_);
+                data_ = nullptr;
+                size_ = 0;
+            }
+
+            [[nodiscard]] uint8_t* getData() const
+            {
+                return static_cast<uint8_t*>(data_);
+            }
+        };
+
+        /**
+         * Разбудить ожидающие процессы
+         * @param word Слово ожидания
+         */
+        inline void FutexWakeAll(std::atomic<uint32_t>* word)
+        {
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+        }
+
+        /**
+         * Ждать изменения слова (не дольше timeoutMs)
+         * @param word Слово ожидания
+         * @param expected Ожидаемое текущее значение
+         * @param timeoutMs Время ожидания в мс (отрицательное - без ограничения)
+         */
+        inline void FutexWait(std::atomic<uint32_t>* word, uint32_t expected, int timeoutMs)
+        {
+            timespec timeout = {timeoutMs / 1000, static_cast<long>(timeoutMs % 1000) * 1000000L};
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, timeoutMs < 0 ? nullptr : &timeout, nullptr, 0);
+        }
+    }
+
+    /**
+     * Кольцо кадров в разделяемой памяти для читателей из других процессов (Linux)
+     * @details Объект разделяемой памяти "/dev/shm/<name>" содержит заголовок и K слотов с кадрами в линейном
+     * расположении (строки выровнены по kImageRowAlignment байт). present копирует кадр в следующий слот по кругу и
+     * никогда не ждет читателей: если слот содержит кадр, который основной читатель еще не прочитал, кадр
+     * перезаписывается и увеличивается счетчик droppedCount. Каждый слот защищен счетчиком последовательной блокировки,
+     * поэтому читатель обращается к пикселям прямо в разделяемой памяти (без копирования) и после обработки проверяет,
+     * что слот не был перезаписан. Ожидание новых кадров - futex на слове в заголовке (работает между процессами).
+     *
+     * Объект разделяемой памяти удаляется при разрушении кольца.
+     * @tparam T Тип пикселей
+     * @tparam LAYOUT Расположение пикселей в буфере кадра
+     * @tparam STORAGE Хранилище пикселей буфера кадра
+     */
+    template<typename T, typename LAYOUT = LinearLayout, typename STORAGE = HeapStorage>
+    class SharedFrameRing : public Presenter<T, LAYOUT, STORAGE>
+    {
+    public:
+        using typename Presenter<T, LAYOUT, STORAGE>::Buffer;
+
+    private:
+        std::string name_;
+        detail::SharedMapping mapping_;
+        SharedFrameRingHeader* header_ = nullptr;
+
+        /**
+         * Получить заголовок слота
+         * @param index Индекс слота
+         * @return Указатель на заголовок
+         */
+        SharedFrameSlotHeader* getSlot(uint64_t index) const
+        {
+            return reinterpret_cast<SharedFrameSlotHeader*>(mapping_.getData() + header_->slotOffset + header_->slotStride * index);
+        }
+
+    public:
+        /**
+         * Конструктор (создание объекта разделяемой памяти)
+         * @details Объект, оставшийся под тем же именем (например после аварийного завершения), сначала удаляется и
+         * создается заново, а не усекается на месте: читатели, которые еще держат старый объект, сохраняют его память
+         * (и не получают SIGBUS), новые читатели подключаются к новому объекту
+         * @param name Имя объекта (например "/gfx-frames")
+         * @param width Ширина кадров
+         * @param height Высота кадров
+         * @param slotCount Кол-во слотов (не меньше 2)
+         */
+        SharedFrameRing(std::string name, unsigned width, unsigned height, unsigned slotCount = 4): name_(std::move(name))
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "Shared frame ring pixels must be trivially copyable");
+
+            const uint64_t pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+            const uint32_t pitch = LinearLayout::Pitch<T>(width);
+            const uint64_t slotOffset = (sizeof(SharedFrameRingHeader) + pageSize - 1) / pageSize * pageSize;
+            const uint64_t slotBytes = sizeof(SharedFrameSlotHeader) + static_cast<uint64_t>(pitch) * height * sizeof(T);
+            const uint64_t slotStride = (slotBytes + pageSize - 1) / pageSize * pageSize;
+            slotCount = std::max(slotCount, 2u);
+            const uint64_t size = slotOffset + slotStride * slotCount;
+
+            if(shm_unlink(name_.c_str()) != 0 && errno != ENOENT){
+                throw std::system_error(errno, std::generic_category(), "Unable to remove stale shared frame ring: " + name_);
+            }
+
+            int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+            if(fd < 0) throw std::system_error(errno, std::generic_category(), "Unable to create shared frame ring: " + name_);
+
+            if(ftruncate(fd, static_cast<off_t>(size)) != 0){
+                int code = errno;
+                ::close(fd);
+                shm_unlink(name_.c_str());
+                throw std::system_error(code, std::generic_category(), "Unable to resize shared frame ring: " + name_);
+            }
+
+            try{
+                mapping_.map(fd, size);
+            }
+            catch(...){
+                ::close(fd);
+                shm_unlink(name_.c_str());
+                throw;
+            }
+            ::close(fd);
+
+            // Новый объект заполнен нулями - атомарные поля и счетчики слотов уже инициализированы
+            header_ = reinterpret_cast<SharedFrameRingHeader*>(mapping_.getData());
+            header_->version = kSharedFrameRingVersion;
+            header_->width = width;
+            header_->height = height;
+            header_->pitch = pitch;
+            header_->pixelSize = sizeof(T);
+            header_->slotCount = slotCount;
+            header_->slotOffset = slotOffset;
+            header_->slotStride = slotStride;
+
+            // Сигнатура записывается последней - читатель не подключится к не заполненному заголовку
+            header_->magic.store(kSharedFrameRingMagic, std::memory_order_release);
+        }
+
+        SharedFrameRing(const SharedFrameRing&) = delete;
+        SharedFrameRing& operator=(const SharedFrameRing&) = delete;
+
+        /**
+         * Удаление объекта разделяемой памяти (подключенные читатели сохраняют доступ до отключения)
+         */
+        ~SharedFrameRing() override
+        {
+            mapping_.unmap();
+            shm_unlink(name_.c_str());
+        }
+
+        /**
+         * Опубликовать кадр (без ожидания читателей)
+         * @details Кадр другого размера не публикуется
+         * @param frame Буфер кадра
+         */
+        void present(const Buffer& frame) override
+        {
+            if(frame.getWidth() != header_->width || frame.getHeight() != header_->height) return;
+
+            const uint64_t sequence = header_->writeSequence.load(std::memory_order_relaxed) + 1;
+            SharedFrameSlotHeader* slot = this->getSlot((sequence - 1) % header_->slotCount);
+
+            // Перезапись кадра, который основной читатель еще не прочитал
+            const uint64_t previous = slot->sequence.load(std::memory_order_relaxed) / 2;
+            if(previous != 0 && previous > header_->readSequence.load(std::memory_order_relaxed)){
+                header_->droppedCount.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            slot->sequence.store(sequence * 2 - 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            auto* pixels = reinterpret_cast<T*>(reinterpret_cast<uint8_t*>(slot) + sizeof(SharedFrameSlotHeader));
+            frame.copyToLinear(pixels, header_->pitch);
+
+            slot->sequence.store(sequence * 2, std::memory_order_release);
+            header_->writeSequence.store(sequence, std::memory_order_release);
+
+            header_->futexWord.store(static_cast<uint32_t>(sequence), std::memory_order_seq_cst);
+            if(header_->waiters.load(std::memory_order_seq_cst) > 0) detail::FutexWakeAll(&header_->futexWord);
+        }
+
+        /**
+         * Получить имя объекта разделяемой памяти
+         * @return
+         */
+        [[nodiscard]] const std::string& getName() const
+        {
+            return name_;
+        }
+
+        /**
+         * Получить кол-во опубликованных кадров
+         * @return Кол-во кадров
+         */
+        [[nodiscard]] uint64_t getWrittenCount() const
+        {
+            return header_->writeSequence.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Получить кол-во кадров, перезаписанных до прочтения
+         * @return Кол-во кадров
+         */
+        [[nodiscard]] uint64_t getDroppedCount() const
+        {
+            return header_->droppedCount.load(std::memory_order_relaxed);
+        }
+    };
+
+    /**
+     * Кадр кольца, доступный читателю без копирования
+     * @tparam T Тип пикселей
+     */
+    template<typename T>
+    struct SharedFrame
+    {
+        /// Номер кадра
+        uint64_t sequence = 0;
+        /// Пиксели кадра в разделяемой памяти
+        ImageBufferView<const T> view;
+    };
+
+    /**
+     * Читатель кольца кадров из другого процесса
+     * @details Основной читатель (primary = true) сообщает кольцу номер прочитанного кадра - по нему считаются
+     * перезаписанные непрочитанные кадры. Пиксели кадра, полученного через acquire, могут быть перезаписаны в любой момент:
+     * после обработки нужно вызвать validate (или использовать copyTo, который проверяет сам).
+     * @tparam T Тип пикселей
+     */
+    template<typename T>
+    class SharedFrameRingReader
+    {
+    private:
+        detail::SharedMapping mapping_;
+        SharedFrameRingHeader* header_ = nullptr;
+        bool primary_;
+        /// Номер последнего полученного кадра
+        uint64_t lastSequence_ = 0;
+
+        /**
+         * Получить заголовок слота
+         * @param index Индекс слота
+         * @return Указатель на заголовок
+         */
+        SharedFrameSlotHeader* getSlot(uint64_t index) const
+        {
+            return reinterpret_cast<SharedFrameSlotHeader*>(mapping_.getData() + header_->slotOffset + header_->slotStride * index);
+        }
+
+        /**
+         * Проверить, что описанное заголовком размещение слотов помещается в отображенную память
+         * @details Заголовок мог записать процесс другой сборки (или он поврежден) - без проверки acquire/copyTo
+         * читали бы за пределами отображения
+         * @param header Заголовок кольца
+         * @param size Размер отображенной памяти в байтах
+         * @return Корректно ли размещение
+         */
+        static bool IsLayoutValid(const SharedFrameRingHeader& header, uint64_t size)
+        {
+            const uint64_t slotAlignment = alignof(SharedFrameSlotHeader);
+            if(header.width == 0 || header.height == 0 || header.slotCount == 0 || header.pitch < header.width) return false;
+            if(header.slotOffset < sizeof(SharedFrameRingHeader) || header.slotOffset > size) return false;
+            if(header.slotOffset % slotAlignment != 0 || header.slotStride % slotAlignment != 0) return false;
+
+            // pitch * height не переполняется (оба меньше 2^32), умножение на размер пикселя проверяется делением
+            const uint64_t pixels = static_cast<uint64_t>(header.pitch) * header.height;
+            if(pixels > (UINT64_MAX - sizeof(SharedFrameSlotHeader)) / header.pixelSize) return false;
+            if(header.slotStride < sizeof(SharedFrameSlotHeader) + pixels * header.pixelSize) return false;
+
+            return header.slotCount <= (size - header.slotOffset) / header.slotStride;
+        }
+
+    public:
+        /**
+         * Конструктор (подключение к объекту разделяемой памяти)
+         * @param name Имя объекта
+         * @param primary Основной читатель
+         */
+        explicit SharedFrameRingReader(const std::string& name, bool primary = true): primary_(primary)
+        {
+            int fd = shm_open(name.c_str(), O_RDWR, 0);
+            if(fd < 0) throw std::system_error(errno, std::generic_category(), "Unable to open shared frame ring: " + name);
+
+            struct stat info = {};
+            if(fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(SharedFrameRingHeader)){
+                ::close(fd);
+                throw std::system_error(std::make_error_code(std::errc::invalid_argument), "Shared frame ring is not initialized: " + name);
+            }
+
+            try{
+                mapping_.map(fd, static_cast<size_t>(info.st_size));
+            }
+            catch(...){
+                ::close(fd);
+                throw;
+            }
+            ::close(fd);
+
+            header_ = reinterpret_cast<SharedFrameRingHeader*>(mapping_.getData());
+            if(header_->magic.load(std::memory_order_acquire) != kSharedFrameRingMagic ||
+               header_->version != kSharedFrameRingVersion || header_->pixelSize != sizeof(T)){
+                throw std::system_error(std::make_error_code(std::errc::invalid_argument), "Shared frame ring format mismatch: " + name);
+            }
+            if(!IsLayoutValid(*header_, static_cast<uint64_t>(info.st_size))){
+                throw std::system_error(std::make_error_code(std::errc::invalid_argument), "Shared frame ring layout is invalid: " + name);
+            }
+        }
+
+        /**
+         * Ждать кадр новее последнего полученного
+         * @param timeoutMs Время ожидания в мс (отрицательное - без ограничения)
+         * @return Есть ли новый кадр
+         */
+        bool wait(int timeoutMs = -1)
+        {
+            while(header_->writeSequence.load(std::memory_order_acquire) <= lastSequence_)
+            {
+                const uint32_t word = header_->futexWord.load(std::memory_order_seq_cst);
+                header_->waiters.fetch_add(1, std::memory_order_seq_cst);
+                if(header_->writeSequence.load(std::memory_order_seq_cst) <= lastSequence_){
+                    detail::FutexWait(&header_->futexWord, word, timeoutMs);
+                }
+                header_->waiters.fetch_sub(1, std::memory_order_seq_cst);
+
+                if(timeoutMs >= 0) return header_->writeSequence.load(std::memory_order_acquire) > lastSequence_;
+            }
+            return true;
+        }
+
+        /**
+         * Получить последний опубликованный кадр (без копирования)
+         * @param frame Кадр (номер и пиксели в разделяемой памяти)
+         * @return Есть ли кадр новее последнего полученного
+         */
+        bool acquire(SharedFrame<T>& frame)
+        {
+            while(true)
+            {
+                const uint64_t sequence = header_->writeSequence.load(std::memory_order_acquire);
+                if(sequence == 0 || sequence <= lastSequence_) return false;
+
+                SharedFrameSlotHeader* slot = this->getSlot((sequence - 1) % header_->slotCount);
+                if(slot->sequence.load(std::memory_order_acquire) != sequence * 2) continue;
+
+                frame.sequence = sequence;
+                frame.view = ImageBufferView<const T>(
+                        reinterpret_cast<const T*>(reinterpret_cast<const uint8_t*>(slot) + sizeof(SharedFrameSlotHeader)),
+                        header_->width, header_->height, header_->pitch);
+
+                lastSequence_ = sequence;
+                if(primary_) header_->readSequence.store(sequence, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        /**
+         * Проверить, что пиксели кадра не были перезаписаны с момента acquire
+         * @param frame Кадр
+         * @return Да или нет
+         */
+        bool validate(const SharedFrame<T>& frame) const
+        {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            SharedFrameSlotHeader* slot = this->getSlot((frame.sequence - 1) % header_->slotCount);
+            return slot->sequence.load(std::memory_order_relaxed) == frame.sequence * 2;
+        }
+
+        /**
+         * Скопировать последний опубликованный кадр
+         * @param dst Указатель на первый пиксель назначения
+         * @param dstPitch Длина строки назначения в элементах
+         * @return Номер скопированного кадра (0 - нового кадра нет)
+         */
+        uint64_t copyTo(T* dst, size_t dstPitch)
+        {
+            SharedFrame<T> frame;
+            while(this->acquire(frame))
+            {
+                for(unsigned y = 0; y < frame.view.getHeight(); y++){
+                    std::copy(frame.view[static_cast<int>(y)], frame.view[static_cast<int>(y)] + frame.view.getWidth(), dst + dstPitch * y);
+                }
+                // Если кадр перезаписан во время копирования - в кольце уже есть более новый
+                if(this->validate(frame)) return frame.sequence;
+            }
+            return 0;
+        }
+
+        [[nodiscard]] unsigned getWidth() const
+        {
+            return header_->width;
+        }
+
+        [[nodiscard]] unsigned getHeight() const
+        {
+            return header_->height;
+        }
+
+        /**
+         * Получить кол-во опубликованных кадров
+         * @return Кол-во кадров
+         */
+        [[nodiscard]] uint64_t getWrittenCount() const
+        {
+            return header_->writeSequence.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Получить кол-во кадров, перезаписанных до прочтения
+         * @return Кол-во кадров
+         */
+        [[nodiscard]] uint64_t getDroppedCount() const
+        {
+            return header_->droppedCount.load(std::memory_order_relaxed);
+        }
+    };
+}
+
+#endif
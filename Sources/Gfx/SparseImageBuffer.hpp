@@ -0,0 +1,439 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
+
+#include "ImageStorage.hpp"
+
+namespace gfx
+{
+    /**
+     * Разреженный буфер двумерного изображения
+     * @details Изображение разбито на тайлы TILE_SIZE x TILE_SIZE, таблица страниц хранит указатель на память каждого
+     * тайла. Память тайла выделяется (и заполняется значением очистки) только при первой записи в него, чтение
+     * нетронутых тайлов возвращает значение очистки. Очистка буфера освобождает все тайлы и не записывает пиксели.
+     * Подходит для больших, преимущественно пустых холстов.
+     *
+     * Доступ через неконстантный operator[] считается записью (выделяет тайл), через константный - чтением.
+     * Тайлы могут выделяться одновременно из нескольких потоков (например тайловым растеризатором), запись в один
+     * пиксель из разных потоков по-прежнему требует внешней синхронизации.
+     *
+     * @tparam T Тип или класс описывающий цвет одного элемента (текселя) текстуры
+     * @tparam TILE_SIZE Размер стороны тайла (страницы) в пикселях (степень двойки)
+     */
+    template<typename T, unsigned TILE_SIZE = 64>
+    class SparseImageBuffer
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "SparseImageBuffer element type must be trivially copyable");
+        static_assert(TILE_SIZE > 0 && (TILE_SIZE & (TILE_SIZE - 1)) == 0, "Tile size must be a power of two");
+
+    public:
+        /// Тип пикселей
+        using ValueType = T;
+
+        /// Кол-во пикселей в тайле
+        static constexpr size_t kTileElements = static_cast<size_t>(TILE_SIZE) * TILE_SIZE;
+
+    private:
+        unsigned width_ = 0;
+        unsigned height_ = 0;
+        unsigned tilesX_ = 0;
+        unsigned tilesY_ = 0;
+
+        /// Значение нетронутых пикселей
+        T clearValue_{};
+        /// Таблица страниц (nullptr - тайл не выделен)
+        std::unique_ptr<std::atomic<T*>[]> tiles_;
+        /// Кол-во выделенных тайлов
+        std::atomic<size_t> allocatedTiles_{0};
+
+        /**
+         * Кол-во тайлов в таблице страниц
+         * @return Кол-во тайлов
+         */
+        [[nodiscard]] size_t getTileCount() const
+        {
+            return static_cast<size_t>(tilesX_) * tilesY_;
+        }
+
+        /**
+         * Создать таблицу страниц под текущие размеры (все тайлы не выделены)
+         */
+        void createPageTable()
+        {
+            tilesX_ = (width_ + TILE_SIZE - 1) / TILE_SIZE;
+            tilesY_ = (height_ + TILE_SIZE - 1) / TILE_SIZE;
+
+            size_t count = this->getTileCount();
+            tiles_.reset(count > 0 ? new std::atomic<T*>[count] : nullptr);
+            for(size_t i = 0; i < count; i++) tiles_[i].store(nullptr, std::memory_order_relaxed);
+            allocatedTiles_.store(0, std::memory_order_relaxed);
+        }
+
+        /**
+         * Освободить память всех тайлов (таблица страниц сохраняется)
+         */
+        void releaseTiles()
+        {
+            size_t count = this->getTileCount();
+            for(size_t i = 0; i < count; i++){
+                T* tile = tiles_[i].exchange(nullptr, std::memory_order_relaxed);
+                if(tile != nullptr) AlignedFree(tile);
+            }
+            allocatedTiles_.store(0, std::memory_order_relaxed);
+        }
+
+        /**
+         * Получить память тайла, выделив ее при первом обращении
+         * @param index Индекс тайла в таблице страниц
+         * @return Указатель на память тайла
+         */
+        T* acquireTile(size_t index)
+        {
+            T* tile = tiles_[index].load(std::memory_order_acquire);
+            if(tile != nullptr) return tile;
+
+            // Выделить и заполнить тайл значением очистки
+            auto* created = static_cast<T*>(AlignedAlloc(kTileElements * sizeof(T), kImageRowAlignment));
+            std::uninitialized_fill_n(created, kTileElements, clearValue_);
+
+            // Тайл мог быть выделен другим потоком одновременно - тогда использовать его
+            if(!tiles_[index].compare_exchange_strong(tile, created, std::memory_order_acq_rel, std::memory_order_acquire)){
+                AlignedFree(created);
+                return tile;
+            }
+
+            allocatedTiles_.fetch_add(1, std::memory_order_relaxed);
+            return created;
+        }
+
+        /**
+         * Индекс тайла, содержащего пиксель
+         * @param x Координаты по X
+         * @param y Координаты по Y
+         * @return Индекс в таблице страниц
+         */
+        [[nodiscard]] size_t tileIndex(unsigned x, unsigned y) const
+        {
+            return static_cast<size_t>(y / TILE_SIZE) * tilesX_ + x / TILE_SIZE;
+        }
+
+        /**
+         * Смещение пикселя внутри тайла
+         * @param x Координаты по X
+         * @param y Координаты по Y
+         * @return Смещение в элементах
+         */
+        static size_t tileOffset(unsigned x, unsigned y)
+        {
+            return static_cast<size_t>(y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE;
+        }
+
+        /**
+         * Скопировать тайлы другого буфера тех же размеров
+         * @param other Буфер-источник
+         */
+        void copyTiles(const SparseImageBuffer& other)
+        {
+            size_t count = this->getTileCount();
+            for(size_t i = 0; i < count; i++)
+            {
+                const T* source = other.tiles_[i].load(std::memory_order_acquire);
+                if(source == nullptr) continue;
+
+                auto* tile = static_cast<T*>(AlignedAlloc(kTileElements * sizeof(T), kImageRowAlignment));
+                memcpy(tile, source, kTileElements * sizeof(T));
+                tiles_[i].store(tile, std::memory_order_relaxed);
+                allocatedTiles_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+    public:
+        /**
+         * Строка изображения для записи (прокси-объект, выделяет тайлы при обращении)
+         */
+        struct Row
+        {
+            SparseImageBuffer* buffer;
+            unsigned y;
+
+            T& operator[](int x) const
+            {
+                auto ux = static_cast<unsigned>(x);
+                return buffer->acquireTile(buffer->tileIndex(ux, y))[tileOffset(ux, y)];
+            }
+        };
+
+        /**
+         * Строка изображения для чтения (прокси-объект, нетронутые пиксели читаются как значение очистки)
+         */
+        struct ConstRow
+        {
+            const SparseImageBuffer* buffer;
+            unsigned y;
+
+            const T& operator[](int x) const
+            {
+                return buffer->at(x, static_cast<int>(y));
+            }
+        };
+
+        /**
+         * Конструктор по умолчанию (инициализация пустого буфера)
+         */
+        SparseImageBuffer() = default;
+
+        /**
+         * Конструктор (память тайлов не выделяется)
+         * @param width Ширина изображения
+         * @param height Высота изображения
+         * @param clear Значение для очистки
+         */
+        SparseImageBuffer(const unsigned width, const unsigned height, const T& clear):
+                width_(width),
+                height_(height),
+                clearValue_(clear)
+        {
+            this->createPageTable();
+        }
+
+        /**
+         * Конструктор копирования (копируются только выделенные тайлы)
+         * @param other Копируемый объект
+         */
+        SparseImageBuffer(const SparseImageBuffer& other):
+                width_(other.width_),
+                height_(other.height_),
+                clearValue_(other.clearValue_)
+        {
+            this->createPageTable();
+            this->copyTiles(other);
+        }
+
+        /**
+         * Конструктор перемещения
+         * @param other Перемещаемый объект
+         */
+        SparseImageBuffer(SparseImageBuffer&& other) noexcept
+        {
+            *this = std::move(other);
+        }
+
+        /**
+         * Оператор присвоения через копирование
+         * @param other Копируемый объект
+         * @return Ссылка на текущий объект
+         */
+        SparseImageBuffer& operator=(const SparseImageBuffer& other)
+        {
+            if(this == &other) return *this;
+
+            this->releaseTiles();
+            width_ = other.width_;
+            height_ = other.height_;
+            clearValue_ = other.clearValue_;
+            this->createPageTable();
+            this->copyTiles(other);
+
+            return *this;
+        }
+
+        /**
+         * Оператор присвоения через перемещение
+         * @param other Перемещаемый объект
+         * @return Ссылка на текущий объект
+         */
+        SparseImageBuffer& operator=(SparseImageBuffer&& other) noexcept
+        {
+            if(this == &other) return *this;
+
+            this->releaseTiles();
+            std::swap(width_, other.width_);
+            std::swap(height_, other.height_);
+            std::swap(tilesX_, other.tilesX_);
+            std::swap(tilesY_, other.tilesY_);
+            std::swap(clearValue_, other.clearValue_);
+            std::swap(tiles_, other.tiles_);
+
+            size_t allocated = other.allocatedTiles_.load(std::memory_order_relaxed);
+            other.allocatedTiles_.store(allocatedTiles_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            allocatedTiles_.store(allocated, std::memory_order_relaxed);
+
+            return *this;
+        }
+
+        /**
+         * Освобождение памяти тайлов
+         */
+        ~SparseImageBuffer()
+        {
+            this->releaseTiles();
+        }
+
+        /**
+         * Оператор для записи в буфер как в двумерный массив
+         * @param y Номер ряда
+         * @return Прокси-объект строки (обращение к пикселю выделяет тайл)
+         */
+        Row operator[](int y)
+        {
+            return {this, static_cast<unsigned>(y)};
+        }
+
+        /**
+         * Оператор для чтения буфера как двумерного массива
+         * @param y Номер ряда
+         * @return Прокси-объект строки (нетронутые пиксели читаются как значение очистки)
+         */
+        ConstRow operator[](int y) const
+        {
+            return {this, static_cast<unsigned>(y)};
+        }
+
+        /**
+         * Прочитать пиксель без выделения тайла
+         * @param x Координаты по X
+         * @param y Координаты по Y
+         * @return Значение пикселя (значение очистки для нетронутых тайлов)
+         */
+        [[nodiscard]] const T& at(int x, int y) const
+        {
+            auto ux = static_cast<unsigned>(x);
+            auto uy = static_cast<unsigned>(y);
+
+            const T* tile = tiles_[this->tileIndex(ux, uy)].load(std::memory_order_acquire);
+            return tile != nullptr ? tile[tileOffset(ux, uy)] : clearValue_;
+        }
+
+        /**
+         * Очистка буфера (освобождает все тайлы, пиксели не записываются)
+         * @param clearValue Новое значение нетронутых пикселей
+         */
+        void clear(const T& clearValue)
+        {
+            this->releaseTiles();
+            clearValue_ = clearValue;
+        }
+
+        /**
+         * Выделен ли тайл
+         * @param tx Номер тайла по X
+         * @param ty Номер тайла по Y
+         * @return Да или нет
+         */
+        [[nodiscard]] bool isTileAllocated(unsigned tx, unsigned ty) const
+        {
+            if(tx >= tilesX_ || ty >= tilesY_) return false;
+            return tiles_[static_cast<size_t>(ty) * tilesX_ + tx].load(std::memory_order_acquire) != nullptr;
+        }
+
+        /**
+         * Получить кол-во выделенных тайлов
+         * @return Кол-во тайлов
+         */
+        [[nodiscard]] size_t getAllocatedTileCount() const
+        {
+            return allocatedTiles_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Получить размер выделенной под пиксели памяти в байтах
+         * @return
+         */
+        [[nodiscard]] size_t getSize() const
+        {
+            return this->getAllocatedTileCount() * kTileElements * sizeof(T);
+        }
+
+        /**
+         * Получить ширину
+         * @return
+         */
+        [[nodiscard]] unsigned int getWidth() const
+        {
+            return width_;
+        }
+
+        /**
+         * Получить высоту
+         * @return
+         */
+        [[nodiscard]] unsigned int getHeight() const
+        {
+            return height_;
+        }
+
+        /**
+         * Получить значение нетронутых пикселей
+         * @return
+         */
+        [[nodiscard]] const T& getClearValue() const
+        {
+            return clearValue_;
+        }
+
+        /**
+         * Копирование изображения в линейный массив
+         * @details Нетронутые тайлы выводятся значением очистки без выделения памяти
+         * @param dst Массив назначения (не менее dstPitch * height элементов)
+         * @param dstPitch Длина строки массива назначения в элементах
+         */
+        void copyToLinear(T* dst, size_t dstPitch) const
+        {
+            for(unsigned ty = 0; ty < tilesY_; ty++)
+            {
+                unsigned y0 = ty * TILE_SIZE;
+                unsigned rows = std::min(TILE_SIZE, height_ - y0);
+
+                for(unsigned tx = 0; tx < tilesX_; tx++)
+                {
+                    unsigned x0 = tx * TILE_SIZE;
+                    unsigned count = std::min(TILE_SIZE, width_ - x0);
+                    const T* tile = tiles_[static_cast<size_t>(ty) * tilesX_ + tx].load(std::memory_order_acquire);
+
+                    for(unsigned row = 0; row < rows; row++){
+                        T* out = dst + dstPitch * (y0 + row) + x0;
+                        if(tile != nullptr) memcpy(out, tile + static_cast<size_t>(row) * TILE_SIZE, count * sizeof(T));
+                        else std::fill_n(out, count, clearValue_);
+                    }
+                }
+            }
+        }
+
+        /**
+         * Проверка попадания точки в границы буфера
+         * @param x Координаты точки по X
+         * @param y Координаты точки по Y
+         * @return Да или нет
+         */
+        [[nodiscard]] bool isPointIn(int x, int y) const
+        {
+            return static_cast<unsigned>(x) < width_ && static_cast<unsigned>(y) < height_;
+        }
+
+        /**
+         * Отложенная очистка в разреженном буфере не используется (нетронутые тайлы и так читаются как очищенные)
+         */
+        void resolveRect(int, int, int, int) const {}
+
+        /**
+         * Отложенная очистка в разреженном буфере не используется (нетронутые тайлы и так читаются как очищенные)
+         */
+        void resolvePoint(int, int) const {}
+
+        /**
+         * Отложенная очистка в разреженном буфере не используется (нетронутые тайлы и так читаются как очищенные)
+         * @return Всегда false
+         */
+        [[nodiscard]] bool hasPendingClear() const
+        {
+            return false;
+        }
+    };
+}
@@ -0,0 +1,272 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <algorithm>
+
+#include "ImageBuffer.hpp"
+
+namespace gfx
+{
+    /**
+     * Цепочка буферов кадра с асинхронным выводом
+     * @details Содержит N буферов кадра. Пока отдельный поток выводит (или кодирует) готовый кадр, вызывающий поток
+     * рисует следующий в другом буфере, поэтому время вывода не добавляется ко времени кадра. Кадры выводятся строго
+     * по порядку (без пропусков); если все буферы кроме текущего ожидают вывода, present блокируется до освобождения
+     * буфера. Передача буферов между потоками выполняется через кольцевые очереди на атомарных индексах без блокировок,
+     * мьютекс используется только для засыпания потока, которому нечего делать.
+     *
+     * Функция вывода вызывается из потока вывода и получает буфер только для чтения; буфер возвращается в цепочку
+     * после возврата из функции.
+     *
+     * @tparam T Тип пикселей
+     * @tparam LAYOUT Расположение пикселей в буферах
+     * @tparam STORAGE Хранилище пикселей буферов (например SharedMemoryStorage для вывода через MIT-SHM)
+     */
+    template<typename T, typename LAYOUT = LinearLayout, typename STORAGE = HeapStorage>
+    class SwapChain
+    {
+    public:
+        /// Тип буфера кадра
+        using Buffer = ImageBuffer<T, LAYOUT, STORAGE>;
+        /// Функция вывода кадра
+        using PresentFn = std::function<void(const Buffer&)>;
+
+    private:
+        /**
+         * Кольцевая очередь индексов буферов (один писатель, один читатель, без блокировок)
+         */
+        class IndexQueue
+        {
+        private:
+            std::unique_ptr<std::atomic<unsigned>[]> slots_;
+            size_t capacity_;
+            std::atomic<size_t> head_{0};
+            std::atomic<size_t> tail_{0};
+
+        public:
+            explicit IndexQueue(size_t capacity): slots_(new std::atomic<unsigned>[capacity]), capacity_(capacity){}
+
+            /**
+             * Добавить индекс (очередь не переполняется - в ней не больше индексов, чем буферов)
+             * @param index Индекс буфера
+             */
+            void push(unsigned index)
+            {
+                size_t tail = tail_.load(std::memory_order_relaxed);
+                slots_[tail % capacity_].store(index, std::memory_order_relaxed);
+                tail_.store(tail + 1, std::memory_order_seq_cst);
+            }
+
+            /**
+             * Извлечь индекс
+             * @param index Извлеченный индекс
+             * @return Был ли индекс в очереди
+             */
+            bool pop(unsigned& index)
+            {
+                size_t head = head_.load(std::memory_order_relaxed);
+                if(head == tail_.load(std::memory_order_seq_cst)) return false;
+
+                index = slots_[head % capacity_].load(std::memory_order_relaxed);
+                head_.store(head + 1, std::memory_order_release);
+                return true;
+            }
+        };
+
+        /**
+         * Сигнал для засыпания потока до появления данных в очереди
+         */
+        struct Signal
+        {
+            std::mutex mutex;
+            std::condition_variable condition;
+            std::atomic<bool> waiting{false};
+
+            /**
+             * Разбудить ожидающий поток (мьютекс захватывается только если поток действительно ждет)
+             */
+            void notify()
+            {
+                if(!waiting.load(std::memory_order_seq_cst)) return;
+                { std::lock_guard<std::mutex> lock(mutex); }
+                condition.notify_one();
+            }
+
+            /**
+             * Ждать выполнения условия
+             * @tparam PREDICATE Тип условия
+             * @param predicate Условие
+             */
+            template<typename PREDICATE>
+            void wait(PREDICATE predicate)
+            {
+                if(predicate()) return;
+
+                std::unique_lock<std::mutex> lock(mutex);
+                waiting.store(true, std::memory_order_seq_cst);
+                condition.wait(lock, predicate);
+                waiting.store(false, std::memory_order_relaxed);
+            }
+        };
+
+        /// Буферы кадра
+        std::vector<Buffer> buffers_;
+        /// Функция вывода
+        PresentFn presentFn_;
+
+        /// Индексы кадров, ожидающих вывода (поток рисования -> поток вывода)
+        IndexQueue presentQueue_;
+        /// Индексы свободных буферов (поток вывода -> поток рисования)
+        IndexQueue freeQueue_;
+        /// Сигнал потоку вывода
+        Signal presentSignal_;
+        /// Сигнал потоку рисования
+        Signal freeSignal_;
+
+        /// Индекс текущего буфера для рисования
+        unsigned backIndex_ = 0;
+        /// Кол-во кадров, переданных на вывод и еще не выведенных
+        std::atomic<unsigned> framesInFlight_{0};
+        /// Кол-во выведенных кадров
+        std::atomic<uint64_t> presentedCount_{0};
+        /// Флаг остановки потока вывода
+        std::atomic<bool> stop_{false};
+        /// Поток вывода
+        std::thread presentThread_;
+
+        /**
+         * Цикл потока вывода
+         */
+        void presentLoop()
+        {
+            while(true)
+            {
+                unsigned index = 0;
+                bool hasFrame = false;
+
+                presentSignal_.wait([&]{
+                    hasFrame = presentQueue_.pop(index);
+                    return hasFrame || stop_.load();
+                });
+
+                // Остановка только после вывода всех поставленных в очередь кадров
+                if(!hasFrame) return;
+
+                if(presentFn_) presentFn_(buffers_[index]);
+                presentedCount_.fetch_add(1, std::memory_order_relaxed);
+
+                freeQueue_.push(index);
+                framesInFlight_.fetch_sub(1, std::memory_order_seq_cst);
+                freeSignal_.notify();
+            }
+        }
+
+    public:
+        /**
+         * Конструктор
+         * @param width Ширина кадра
+         * @param height Высота кадра
+         * @param clearValue Начальное значение пикселей
+         * @param presentFn Функция вывода кадра (вызывается из потока вывода)
+         * @param bufferCount Кол-во буферов (не меньше 2, по умолчанию 3 - тройная буферизация)
+         */
+        SwapChain(unsigned width, unsigned height, const T& clearValue, PresentFn presentFn, unsigned bufferCount = 3):
+                presentFn_(std::move(presentFn)),
+                presentQueue_(std::max(bufferCount, 2u)),
+                freeQueue_(std::max(bufferCount, 2u))
+        {
+            bufferCount = std::max(bufferCount, 2u);
+            buffers_.reserve(bufferCount);
+            for(unsigned i = 0; i < bufferCount; i++) buffers_.emplace_back(width, height, clearValue, STORAGE());
+
+            // Буфер 0 - текущий для рисования, остальные свободны
+            for(unsigned i = 1; i < bufferCount; i++) freeQueue_.push(i);
+
+            presentThread_ = std::thread([this]{ presentLoop(); });
+        }
+
+        SwapChain(const SwapChain&) = delete;
+        SwapChain& operator=(const SwapChain&) = delete;
+
+        /**
+         * Вывод оставшихся кадров и остановка потока вывода
+         */
+        ~SwapChain()
+        {
+            stop_.store(true);
+            { std::lock_guard<std::mutex> lock(presentSignal_.mutex); }
+            presentSignal_.condition.notify_one();
+            presentThread_.join();
+        }
+
+        /**
+         * Получить буфер для рисования текущего кадра
+         * @return Ссылка на буфер
+         */
+        Buffer& getBackBuffer()
+        {
+            return buffers_[backIndex_];
+        }
+
+        /**
+         * Передать текущий кадр на вывод и перейти к следующему буферу
+         * @details Содержимое следующего буфера - кадр, выведенный N-1 кадров назад (очистка - на стороне вызывающего)
+         * @return Ссылка на буфер для рисования следующего кадра
+         */
+        Buffer& present()
+        {
+            framesInFlight_.fetch_add(1, std::memory_order_seq_cst);
+            presentQueue_.push(backIndex_);
+            presentSignal_.notify();
+
+            unsigned next = 0;
+            freeSignal_.wait([&]{ return freeQueue_.pop(next); });
+            backIndex_ = next;
+
+            return buffers_[backIndex_];
+        }
+
+        /**
+         * Дождаться вывода всех переданных кадров
+         */
+        void waitIdle()
+        {
+            freeSignal_.wait([&]{ return framesInFlight_.load() == 0; });
+        }
+
+        /**
+         * Получить буфер цепочки по индексу (например для регистрации буферов в объекте вывода до начала вывода)
+         * @param index Индекс буфера (меньше getBufferCount())
+         * @return Ссылка на буфер
+         */
+        [[nodiscard]] const Buffer& getBuffer(unsigned index) const
+        {
+            return buffers_[index];
+        }
+
+        /**
+         * Получить кол-во буферов
+         * @return Кол-во буферов
+         */
+        [[nodiscard]] unsigned getBufferCount() const
+        {
+            return static_cast<unsigned>(buffers_.size());
+        }
+
+        /**
+         * Получить кол-во выведенных кадров
+         * @return Кол-во кадров
+         */
+        [[nodiscard]] uint64_t getPresentedCount() const
+        {
+            return presentedCount_.load(std::memory_order_relaxed);
+        }
+    };
+}
@@ -0,0 +1,305 @@
+#pragma once
+
+#include "Rasterizer.hpp"
+
+#include <ThreadPool.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+namespace gfx
+{
+    /// Размер стороны тайла тайлового растеризатора по умолчанию
+    constexpr int kDefaultRasterizerTileSize = 64;
+
+    /**
+     * Растеризатор с разбиением экрана на тайлы (sort-middle)
+     * @details Вызовы DrawTriangle/DrawIndexed только обрабатывают вершины, отсекают треугольники и раскладывают их
+     * по корзинам тайлов экрана (по описывающему прямоугольнику). Растеризация выполняется в Flush: тайлы обрабатываются
+     * рабочими потоками независимо, каждый тайл пишет только в свою область буферов цвета и глубины. В пределах тайла
+     * треугольники растеризуются в порядке отправки, поэтому результат не зависит от кол-ва потоков.
+     *
+     * Если размер буфера цвета изменился между отправкой треугольников и Flush, накопленные треугольники переводятся
+     * в координаты нового размера (с точностью до под-пикселя) и раскладываются заново.
+     *
+     * Фрагментный шейдер вызывается одновременно из нескольких потоков и должен быть потокобезопасным.
+     *
+     * @tparam VERTEX Тип вершины (требования как у BasicRasterizer)
+     * @tparam COLOR Тип пикселей буфера цвета
+     * @tparam DEPTH Тип пикселей буфера глубины
+     * @tparam VERTEX_SHADER Функтор вершинного шейдера
+     * @tparam FRAGMENT_SHADER Функтор фрагментного шейдера
+     * @tparam COLOR_BUFFER Тип буфера цвета (ImageBuffer с любым расположением или ImageBufferView)
+     * @tparam DEPTH_BUFFER Тип буфера глубины (ImageBuffer с любым расположением или ImageBufferView)
+     */
+    template <typename VERTEX, typename COLOR, typename DEPTH, typename VERTEX_SHADER, typename FRAGMENT_SHADER,
+              typename COLOR_BUFFER = ImageBuffer<COLOR>, typename DEPTH_BUFFER = ImageBuffer<DEPTH>>
+    class TiledRasterizer : public BasicRasterizer<VERTEX, COLOR, DEPTH, VERTEX_SHADER, FRAGMENT_SHADER, COLOR_BUFFER, DEPTH_BUFFER>
+    {
+    private:
+        using Base = BasicRasterizer<VERTEX, COLOR, DEPTH, VERTEX_SHADER, FRAGMENT_SHADER, COLOR_BUFFER, DEPTH_BUFFER>;
+        using ScreenVertex = typename Base::ScreenVertex;
+        using ScissorRect = typename Base::ScissorRect;
+
+        /**
+         * Треугольник, прошедший обработку вершин и отсечение (готовый к растеризации)
+         */
+        struct BinnedTriangle
+        {
+            ScreenVertex screen[3];
+            VERTEX vertex[3];
+        };
+
+        /// Указатель на пул потоков (nullptr - растеризация в вызывающем потоке)
+        tools::ThreadPool* pThreadPool_;
+        /// Размер стороны тайла в пикселях
+        int tileSize_;
+        /// Кол-во тайлов по горизонтали
+        int tilesX_ = 0;
+        /// Кол-во тайлов по вертикали
+        int tilesY_ = 0;
+        /// Ширина буфера цвета, под которую разложены треугольники
+        unsigned gridWidth_ = 0;
+        /// Высота буфера цвета, под которую разложены треугольники
+        unsigned gridHeight_ = 0;
+
+        /// Треугольники текущего кадра
+        std::vector<BinnedTriangle> triangles_;
+        /// Корзины тайлов (индексы треугольников, попавших в тайл)
+        std::vector<std::vector<uint32_t>> bins_;
+
+        /**
+         * Подготовить сетку тайлов под текущий размер буфера цвета
+         * @details Если буфер изменил размер, уже разложенные треугольники переводятся в координаты экрана нового размера
+         * (перевод из клип-пространства линейный по каждой оси) и раскладываются по новой сетке заново
+         */
+        void updateTileGrid()
+        {
+            const unsigned width = this->pColorBuffer_->getWidth();
+            const unsigned height = this->pColorBuffer_->getHeight();
+            if(width == gridWidth_ && height == gridHeight_) return;
+
+            const double scaleX = gridWidth_ > 0 ? static_cast<double>(width) / gridWidth_ : 1.0;
+            const double scaleY = gridHeight_ > 0 ? static_cast<double>(height) / gridHeight_ : 1.0;
+
+            gridWidth_ = width;
+            gridHeight_ = height;
+            tilesX_ = (static_cast<int>(width) + tileSize_ - 1) / tileSize_;
+            tilesY_ = (static_cast<int>(height) + tileSize_ - 1) / tileSize_;
+            bins_.assign(static_cast<size_t>(tilesX_) * static_cast<size_t>(tilesY_), {});
+
+            if(triangles_.empty()) return;
+
+            std::vector<BinnedTriangle> previous;
+            previous.swap(triangles_);
+            triangles_.reserve(previous.size());
+
+            for(BinnedTriangle& triangle : previous)
+            {
+                for(ScreenVertex& vertex : triangle.screen){
+                    vertex.x = static_cast<int64_t>(std::llround(static_cast<double>(vertex.x) * scaleX));
+                    vertex.y = static_cast<int64_t>(std::llround(static_cast<double>(vertex.y) * scaleY));
+                }
+
+                const ScreenVertex* s[3] = {&triangle.screen[0], &triangle.screen[1], &triangle.screen[2]};
+                const VERTEX* v[3] = {&triangle.vertex[0], &triangle.vertex[1], &triangle.vertex[2]};
+                binTriangle(s, v);
+            }
+        }
+
+        /**
+         * Разложить треугольник по корзинам тайлов
+         * @param s Указатели на вершины в пространстве экрана
+         * @param v Указатели на выходные данные вершинного шейдера
+         */
+        void binTriangle(const ScreenVertex* const* s, const VERTEX* const* v)
+        {
+            if(!this->IsVisible(Base::SignedArea(s))) return;
+
+            // Описывающий прямоугольник (в пикселях)
+            int64_t minX = std::min(s[0]->x, std::min(s[1]->x, s[2]->x)) >> Base::kSubPixelBits;
+            int64_t minY = std::min(s[0]->y, std::min(s[1]->y, s[2]->y)) >> Base::kSubPixelBits;
+            int64_t maxX = std::max(s[0]->x, std::max(s[1]->x, s[2]->x)) >> Base::kSubPixelBits;
+            int64_t maxY = std::max(s[0]->y, std::max(s[1]->y, s[2]->y)) >> Base::kSubPixelBits;
+
+            int tileMinX = static_cast<int>(std::max<int64_t>(minX, 0) / tileSize_);
+            int tileMinY = static_cast<int>(std::max<int64_t>(minY, 0) / tileSize_);
+            int tileMaxX = static_cast<int>(std::min<int64_t>(maxX / tileSize_, tilesX_ - 1));
+            int tileMaxY = static_cast<int>(std::min<int64_t>(maxY / tileSize_, tilesY_ - 1));
+            if(tileMinX > tileMaxX || tileMinY > tileMaxY) return;
+
+            auto index = static_cast<uint32_t>(triangles_.size());
+            triangles_.push_back({{*s[0], *s[1], *s[2]}, {*v[0], *v[1], *v[2]}});
+
+            for(int ty = tileMinY; ty <= tileMaxY; ty++){
+                for(int tx = tileMinX; tx <= tileMaxX; tx++){
+                    bins_[static_cast<size_t>(ty) * tilesX_ + tx].push_back(index);
+                }
+            }
+        }
+
+        /**
+         * Растеризовать все треугольники одного тайла
+         * @param tileIndex Индекс тайла
+         */
+        void rasterizeTile(size_t tileIndex)
+        {
+            auto& bin = bins_[tileIndex];
+            if(bin.empty()) return;
+
+            int tx = static_cast<int>(tileIndex % tilesX_);
+            int ty = static_cast<int>(tileIndex / tilesX_);
+
+            ScissorRect full = this->FullScissor();
+            ScissorRect scissor = {
+                    tx * tileSize_,
+                    ty * tileSize_,
+                    std::min(tx * tileSize_ + tileSize_ - 1, full.maxX),
+                    std::min(ty * tileSize_ + tileSize_ - 1, full.maxY)
+            };
+
+            for(uint32_t index : bin)
+            {
+                const BinnedTriangle& triangle = triangles_[index];
+                const ScreenVertex* s[3] = {&triangle.screen[0], &triangle.screen[1], &triangle.screen[2]};
+                const VERTEX* v[3] = {&triangle.vertex[0], &triangle.vertex[1], &triangle.vertex[2]};
+                this->RasterizeScreenTriangle(s, v, scissor);
+            }
+
+            bin.clear();
+        }
+
+    public:
+        /**
+         * Основной конструктор
+         * @param pColorBuffer Указатель на буфер цвета
+         * @param pDepthBuffer Указатель на буфер глубины
+         * @param vertexShaderFn Функтор вершинного шейдера
+         * @param fragmentShaderFn Функтор фрагментного шейдера (потокобезопасный)
+         * @param pThreadPool Указатель на пул потоков (nullptr - растеризация в вызывающем потоке)
+         * @param tileSize Размер стороны тайла в пикселях (округляется вверх до кратного kLazyClearTileSize, чтобы потоки
+         * не выполняли отложенную очистку одних и тех же тайлов буфера)
+         * @param frontFace Как описывается передняя грань
+         * @param backFaceCooling Отсечение задних граней
+         */
+        TiledRasterizer(COLOR_BUFFER* pColorBuffer,
+                        DEPTH_BUFFER* pDepthBuffer,
+                        VERTEX_SHADER vertexShaderFn,
+                        FRAGMENT_SHADER fragmentShaderFn,
+                        tools::ThreadPool* pThreadPool,
+                        int tileSize = kDefaultRasterizerTileSize,
+                        RasterizerTypes::FrontFace frontFace = RasterizerTypes::FrontFace::eClockWise,
+                        bool backFaceCooling = true):
+                Base(pColorBuffer, pDepthBuffer, std::move(vertexShaderFn), std::move(fragmentShaderFn), frontFace, backFaceCooling),
+                pThreadPool_(pThreadPool),
+                tileSize_(((std::max(tileSize, 1) + kLazyClearTileSize - 1) / kLazyClearTileSize) * kLazyClearTileSize)
+        {}
+
+        /**
+         * Добавить треугольник в кадр (растеризация откладывается до вызова Flush)
+         * @param v0 Первая вершина
+         * @param v1 Вторая вершина
+         * @param v2 Третья вершина
+         */
+        void DrawTriangle(const VERTEX& v0, const VERTEX& v1, const VERTEX& v2)
+        {
+            if(!this->isReady()) return;
+            updateTileGrid();
+
+            this->TransformTriangle(v0, v1, v2, [&](const ScreenVertex* const* s, const VERTEX* const* v){
+                binTriangle(s, v);
+            });
+        }
+
+        /**
+         * Добавить индексированный список треугольников в кадр (растеризация откладывается до вызова Flush)
+         * @param vertices Массив вершин
+         * @param count Кол-во вершин
+         * @param indices Массив индексов (по три на треугольник)
+         * @param indexCount Кол-во индексов
+         */
+        void DrawIndexed(const VERTEX* vertices, size_t count, const uint32_t* indices, size_t indexCount)
+        {
+            if(!this->isReady()) return;
+            updateTileGrid();
+
+            this->TransformIndexed(vertices, count, indices, indexCount, [&](const ScreenVertex* const* s, const VERTEX* const* v){
+                binTriangle(s, v);
+            });
+        }
+
+        /**
+         * Растеризовать все накопленные треугольники (параллельно по тайлам) и очистить корзины
+         * @details Исключение из шейдера пробрасывается после остановки всех потоков, недорисованный кадр отбрасывается
+         */
+        void Flush()
+        {
+            if(triangles_.empty() || !this->isReady()) return;
+            updateTileGrid();
+
+            try{
+                if(pThreadPool_ != nullptr){
+                    pThreadPool_->parallelFor(bins_.size(), [this](size_t tileIndex){ rasterizeTile(tileIndex); });
+                }
+                else{
+                    for(size_t i = 0; i < bins_.size(); i++) rasterizeTile(i);
+                }
+            }
+            catch(...){
+                // Исключение из шейдера - кадр отбрасывается целиком, чтобы не растеризовать остаток в следующем Flush
+                for(auto& bin : bins_) bin.clear();
+                triangles_.clear();
+                throw;
+            }
+
+            triangles_.clear();
+        }
+
+        /**
+         * Получить кол-во треугольников ожидающих растеризации
+         * @return Кол-во треугольников
+         */
+        [[nodiscard]] size_t getPendingTriangleCount() const
+        {
+            return triangles_.size();
+        }
+    };
+
+    /**
+     * Создать тайловый растеризатор с шейдерами, привязанными на этапе компиляции
+     * @tparam VERTEX Тип вершины
+     * @tparam COLOR Тип пикселей буфера цвета
+     * @tparam DEPTH Тип пикселей буфера глубины
+     * @tparam VERTEX_SHADER Тип функтора вершинного шейдера (выводится)
+     * @tparam FRAGMENT_SHADER Тип функтора фрагментного шейдера (выводится)
+     * @tparam COLOR_BUFFER Тип буфера цвета (выводится)
+     * @tparam DEPTH_BUFFER Тип буфера глубины (выводится)
+     * @param pColorBuffer Указатель на буфер цвета
+     * @param pDepthBuffer Указатель на буфер глубины
+     * @param vertexShaderFn Функтор вершинного шейдера
+     * @param fragmentShaderFn Функтор фрагментного шейдера (потокобезопасный)
+     * @param pThreadPool Указатель на пул потоков
+     * @param tileSize Размер стороны тайла в пикселях
+     * @param frontFace Как описывается передняя грань
+     * @param backFaceCooling Отсечение задних граней
+     * @return Объект растеризатора
+     */
+    template <typename VERTEX, typename COLOR, typename DEPTH, typename VERTEX_SHADER, typename FRAGMENT_SHADER,
+              typename COLOR_BUFFER, typename DEPTH_BUFFER>
+    TiledRasterizer<VERTEX, COLOR, DEPTH, VERTEX_SHADER, FRAGMENT_SHADER, COLOR_BUFFER, DEPTH_BUFFER> MakeTiledRasterizer(
+            COLOR_BUFFER* pColorBuffer,
+            DEPTH_BUFFER* pDepthBuffer,
+            VERTEX_SHADER vertexShaderFn,
+            FRAGMENT_SHADER fragmentShaderFn,
+            tools::ThreadPool* pThreadPool,
+            int tileSize = kDefaultRasterizerTileSize,
+            RasterizerTypes::FrontFace frontFace = RasterizerTypes::FrontFace::eClockWise,
+            bool backFaceCooling = true)
+    {
+        return TiledRasterizer<VERTEX, COLOR, DEPTH, VERTEX_SHADER, FRAGMENT_SHADER, COLOR_BUFFER, DEPTH_BUFFER>(
+                pColorBuffer, pDepthBuffer, std::move(vertexShaderFn), std::move(fragmentShaderFn),
+                pThreadPool, tileSize, frontFace, backFaceCooling);
+    }
+}
@@ -0,0 +1,356 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <cstdint>
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+
+#include "Presenter.hpp"
+#include "Pixel.hpp"
+
+namespace gfx
+{
+    /**
+     * Вывод кадров в окно X11 через разделяемую память (расширение MIT-SHM)
+     * @details Буферы кадра хранятся в сегментах разделяемой памяти (SharedMemoryStorage), и для каждого буфера при
+     * регистрации (attach) один раз создается XImage, указывающий прямо на пиксели буфера. Вывод кадра - XShmPutImage
+     * без копирования пикселей и без выделения памяти. После вывода выполняется XSync, поэтому к моменту возврата из
+     * present сервер закончил чтение буфера и буфер можно снова использовать для рисования.
+     *
+     * Если сервер не поддерживает MIT-SHM (например удаленный дисплей), кадр передается обычным XPutImage из того же
+     * XImage. Требуется 24/32-битный TrueColor визуал с порядком каналов BGRA (как у PixelBGRA).
+     *
+     * Все обращения к соединению с сервером после создания выполняются из потока, вызывающего present (потока вывода
+     * SwapChain). Буферы регистрируются до начала вывода, либо автоматически при первом выводе.
+     *
+     * Поверхность сопоставляется буферу по адресу пикселей, сегменту, размерам и длине строки: если буфер изменил размер
+     * (SwapChain::getBackBuffer допускает resize), поверхность пересоздается. Поверхности, которые давно не выводились
+     * (буфер освобожден или перевыделен по другому адресу), отключаются от сервера и освобождаются.
+     * @tparam T Тип пикселей (4 байта, порядок BGRA)
+     */
+    template<typename T>
+    class X11ShmPresenter : public Presenter<T, LinearLayout, SharedMemoryStorage>
+    {
+        static_assert(sizeof(T) == 4, "X11ShmPresenter requires 32-bit BGRA pixels");
+
+    public:
+        using typename Presenter<T, LinearLayout, SharedMemoryStorage>::Buffer;
+
+    private:
+        /**
+         * Поверхность вывода (XImage над пикселями буфера кадра)
+         */
+        struct Surface
+        {
+            const T* data = nullptr;
+            int segmentId = -1;
+            unsigned width = 0;
+            unsigned height = 0;
+            unsigned pitch = 0;
+            /// Номер вывода, на котором поверхность использовалась последней
+            uint64_t lastPresent = 0;
+            XImage* image = nullptr;
+            XShmSegmentInfo segment = {};
+            bool attached = false;
+        };
+
+        Display* display_ = nullptr;
+        Visual* visual_ = nullptr;
+        int depth_ = 0;
+        Window window_ = 0;
+        GC gc_ = nullptr;
+        Atom wmDeleteWindow_ = 0;
+
+        /// Использовать MIT-SHM
+        bool useShm_ = false;
+        /// Окно открыто
+        std::atomic<bool> open_{true};
+        /// Поверхности зарегистрированных буферов
+        std::vector<std::unique_ptr<Surface>> surfaces_;
+        /// Кол-во выведенных кадров
+        uint64_t presentCount_ = 0;
+
+        /**
+         * Соответствует ли поверхность текущему состоянию буфера
+         * @param surface Поверхность
+         * @param buffer Буфер кадра
+         * @return Да или нет
+         */
+        static bool matches(const Surface& surface, const Buffer& buffer)
+        {
+            return surface.segmentId == buffer.getStorage().getSegmentId() &&
+                   surface.width == buffer.getWidth() &&
+                   surface.height == buffer.getHeight() &&
+                   surface.pitch == buffer.getPitch();
+        }
+
+        /**
+         * Найти поверхность буфера (или зарегистрировать буфер)
+         * @details Поверхность с тем же адресом пикселей, но другим сегментом или размерами освобождается и создается заново
+         * @param buffer Буфер кадра
+         * @return Указатель на поверхность
+         */
+        Surface* getSurface(const Buffer& buffer)
+        {
+            for(auto it = surfaces_.begin(); it != surfaces_.end(); ++it)
+            {
+                if((*it)->data != buffer.getData()) continue;
+                if(matches(**it, buffer)) return it->get();
+
+                this->destroySurface(**it);
+                surfaces_.erase(it);
+                break;
+            }
+            return this->createSurface(buffer);
+        }
+
+        /**
+         * Освободить поверхности, которые не выводились дольше двух полных циклов цепочки буферов
+         * @details Буферы цепочки выводятся по очереди, поэтому живая поверхность используется не реже чем раз в
+         * surfaces_.size() выводов. Ошибочно освобожденная поверхность будет просто создана заново при следующем выводе.
+         */
+        void releaseStaleSurfaces()
+        {
+            const uint64_t maxIdle = static_cast<uint64_t>(surfaces_.size()) * 2;
+
+            for(auto it = surfaces_.begin(); it != surfaces_.end();)
+            {
+                if(presentCount_ - (*it)->lastPresent > maxIdle){
+                    this->destroySurface(**it);
+                    it = surfaces_.erase(it);
+                }
+                else{
+                    ++it;
+                }
+            }
+        }
+
+        /**
+         * Флаг ошибки X-сервера при подключении сегмента
+         * @return Ссылка на флаг
+         */
+        static std::atomic<bool>& attachFailed()
+        {
+            static std::atomic<bool> failed{false};
+            return failed;
+        }
+
+        /**
+         * Обработчик ошибок X-сервера на время подключения сегмента (стандартный завершает процесс)
+         * @return Код обработки
+         */
+        static int onAttachError(Display*, XErrorEvent*)
+        {
+            attachFailed().store(true);
+            return 0;
+        }
+
+        /**
+         * Создать поверхность буфера (XImage над его пикселями) и подключить сегмент к серверу
+         * @param buffer Буфер кадра (память - сегмент разделяемой памяти)
+         * @return Указатель на поверхность
+         */
+        Surface* createSurface(const Buffer& buffer)
+        {
+            std::unique_ptr<Surface> surface(new Surface());
+            surface->data = buffer.getData();
+            surface->segmentId = buffer.getStorage().getSegmentId();
+            surface->width = buffer.getWidth();
+            surface->height = buffer.getHeight();
+            surface->pitch = buffer.getPitch();
+            surface->lastPresent = presentCount_;
+
+            // Ширина образа - длина строки буфера, выводится только видимая часть
+            auto* pixels = const_cast<char*>(reinterpret_cast<const char*>(buffer.getData()));
+
+            if(useShm_){
+                surface->segment.shmid = buffer.getStorage().getSegmentId();
+                surface->segment.shmaddr = pixels;
+                surface->segment.readOnly = True;
+
+                surface->image = XShmCreateImage(display_, visual_, static_cast<unsigned>(depth_), ZPixmap, pixels,
+                                                 &surface->segment, buffer.getPitch(), buffer.getHeight());
+
+                // Ошибка подключения приходит асинхронно - дождаться ответа сервера с временным обработчиком ошибок
+                if(surface->image != nullptr){
+                    attachFailed().store(false);
+                    auto previousHandler = XSetErrorHandler(&X11ShmPresenter::onAttachError);
+                    surface->attached = XShmAttach(display_, &surface->segment) != 0;
+                    XSync(display_, False);
+                    XSetErrorHandler(previousHandler);
+                    surface->attached = surface->attached && !attachFailed().load();
+                }
+
+                if(!surface->attached){
+                    this->destroySurface(*surface);
+                    useShm_ = false;
+                }
+            }
+
+            if(surface->image == nullptr){
+                surface->image = XCreateImage(display_, visual_, static_cast<unsigned>(depth_), ZPixmap, 0, pixels,
+                                              buffer.getPitch(), buffer.getHeight(), 32,
+                                              static_cast<int>(buffer.getPitch() * sizeof(T)));
+                if(surface->image == nullptr) throw std::runtime_error("ERROR: Can't create X image.");
+            }
+
+            surfaces_.push_back(std::move(surface));
+            return surfaces_.back().get();
+        }
+
+        /**
+         * Освободить поверхность
+         * @param surface Поверхность
+         */
+        void destroySurface(Surface& surface)
+        {
+            if(surface.attached) XShmDetach(display_, &surface.segment);
+            if(surface.image != nullptr){
+                // Пиксели принадлежат буферу кадра - XDestroyImage не должен их освобождать
+                surface.image->data = nullptr;
+                XDestroyImage(surface.image);
+            }
+            surface.image = nullptr;
+            surface.attached = false;
+        }
+
+        /**
+         * Обработать события окна (закрытие)
+         */
+        void processEvents()
+        {
+            while(XPending(display_) > 0)
+            {
+                XEvent event;
+                XNextEvent(display_, &event);
+
+                if(event.type == ClientMessage && static_cast<Atom>(event.xclient.data.l[0]) == wmDeleteWindow_){
+                    open_.store(false);
+                }
+                else if(event.type == DestroyNotify){
+                    open_.store(false);
+                }
+            }
+        }
+
+    public:
+        /**
+         * Конструктор (открытие соединения с X-сервером и создание окна)
+         * @param width Ширина окна
+         * @param height Высота окна
+         * @param title Заголовок окна
+         * @param displayName Имя дисплея (nullptr - переменная окружения DISPLAY)
+         */
+        X11ShmPresenter(unsigned width, unsigned height, const std::string& title, const char* displayName = nullptr)
+        {
+            XInitThreads();
+
+            display_ = XOpenDisplay(displayName);
+            if(display_ == nullptr) throw std::runtime_error("ERROR: Can't open X display.");
+
+            int screen = DefaultScreen(display_);
+
+            XVisualInfo visualInfo;
+            if(!XMatchVisualInfo(display_, screen, 24, TrueColor, &visualInfo) ||
+               visualInfo.red_mask != 0xFF0000 || visualInfo.green_mask != 0x00FF00 || visualInfo.blue_mask != 0x0000FF){
+                XCloseDisplay(display_);
+                throw std::runtime_error("ERROR: X display has no 24-bit BGRA TrueColor visual.");
+            }
+            visual_ = visualInfo.visual;
+            depth_ = visualInfo.depth;
+
+            useShm_ = XShmQueryExtension(display_) == True;
+
+            XSetWindowAttributes attributes = {};
+            attributes.colormap = XCreateColormap(display_, RootWindow(display_, screen), visual_, AllocNone);
+            attributes.background_pixel = 0;
+            attributes.border_pixel = 0;
+            attributes.event_mask = StructureNotifyMask;
+
+            window_ = XCreateWindow(display_, RootWindow(display_, screen), 0, 0, width, height, 0, depth_, InputOutput,
+                                    visual_, CWColormap | CWBackPixel | CWBorderPixel | CWEventMask, &attributes);
+            XStoreName(display_, window_, title.c_str());
+
+            wmDeleteWindow_ = XInternAtom(display_, "WM_DELETE_WINDOW", False);
+            XSetWMProtocols(display_, window_, &wmDeleteWindow_, 1);
+
+            gc_ = XCreateGC(display_, window_, 0, nullptr);
+
+            XMapWindow(display_, window_);
+            XSync(display_, False);
+        }
+
+        X11ShmPresenter(const X11ShmPresenter&) = delete;
+        X11ShmPresenter& operator=(const X11ShmPresenter&) = delete;
+
+        /**
+         * Освобождение поверхностей, окна и соединения
+         * @details Объект вывода разрушается после цепочки буферов, которая его использует
+         */
+        ~X11ShmPresenter() override
+        {
+            for(auto& surface : surfaces_) this->destroySurface(*surface);
+            surfaces_.clear();
+
+            XFreeGC(display_, gc_);
+            XDestroyWindow(display_, window_);
+            XCloseDisplay(display_);
+        }
+
+        /**
+         * Зарегистрировать буфер кадра (создать XImage над его пикселями и подключить сегмент к серверу)
+         * @details Вызывается для всех буферов цепочки до начала вывода (SwapChain::getBuffer)
+         * @param buffer Буфер кадра
+         */
+        void attach(const Buffer& buffer)
+        {
+            this->getSurface(buffer);
+        }
+
+        /**
+         * Вывести кадр в окно
+         * @param frame Буфер кадра
+         */
+        void present(const Buffer& frame) override
+        {
+            Surface* surface = this->getSurface(frame);
+            surface->lastPresent = ++presentCount_;
+
+            if(surface->attached){
+                XShmPutImage(display_, window_, gc_, surface->image, 0, 0, 0, 0, frame.getWidth(), frame.getHeight(), False);
+            }
+            else{
+                XPutImage(display_, window_, gc_, surface->image, 0, 0, 0, 0, frame.getWidth(), frame.getHeight());
+            }
+
+            // Дождаться чтения буфера сервером до возврата буфера в цепочку
+            XSync(display_, False);
+            this->releaseStaleSurfaces();
+            this->processEvents();
+        }
+
+        /**
+         * Открыто ли окно
+         * @return Да или нет
+         */
+        [[nodiscard]] bool isOpen() const override
+        {
+            return open_.load();
+        }
+
+        /**
+         * Используется ли разделяемая память (MIT-SHM)
+         * @return Да или нет
+         */
+        [[nodiscard]] bool isUsingShm() const
+        {
+            return useShm_;
+        }
+    };
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+#include <Math.hpp>
+#include <Pixel.hpp>
+#include <Rasterizer.hpp>
+
+namespace samples
+{
+    /**
+     * Вершина меша (входные и выходные данные вершинного шейдера)
+     */
+    struct MeshVertex
+    {
+        /// Положение в пространстве модели
+        math::Vec3<float> position;
+        /// Нормаль грани в пространстве модели
+        math::Vec3<float> normal;
+        /// Цвет с учетом освещения (RGB в диапазоне от 0 до 1, заполняет вершинный шейдер)
+        math::Vec3<float> color;
+
+        MeshVertex operator+(const MeshVertex& other) const
+        {
+            return {position + other.position, normal + other.normal, color + other.color};
+        }
+
+        MeshVertex operator*(float value) const
+        {
+            return {position * value, normal * value, color * value};
+        }
+    };
+
+    /**
+     * Параметры отрисовки меша (общие для всех его вершин)
+     */
+    struct MeshUniforms
+    {
+        /// Положение меша
+        math::Vec3<float> position;
+        /// Ориентация меша
+        math::Vec3<float> orientation;
+        /// Цвет (RGB в диапазоне от 0 до 1)
+        math::Vec3<float> color;
+        /// Пропорции области вида
+        float aspectRatio = 1.0f;
+    };
+
+    /**
+     * Вершинный шейдер: поворот и перенос меша, перспективная проекция, освещение грани
+     * @details Проекция совпадает с math::ProjectPerspective (угол обзора 90, ближняя и дальняя грани 0.1 и 100),
+     * глубина приводится к диапазону клип-пространства растеризатора (0 <= z <= w)
+     */
+    struct MeshVertexShader
+    {
+        /// Параметры текущего меша
+        const MeshUniforms* uniforms;
+
+        MeshVertex operator()(const MeshVertex& vertex, gfx::RasterizerTypes::Vec4* outPosition) const
+        {
+            constexpr float kNear = 0.1f;
+            constexpr float kFar = 100.0f;
+            constexpr float kHalfFovTan = 1.0f;
+
+            auto p = math::RotateAroundX(vertex.position, uniforms->orientation.x);
+            p = math::RotateAroundY(p, uniforms->orientation.y);
+            p = math::RotateAroundZ(p, uniforms->orientation.z);
+            p = p + uniforms->position;
+
+            auto n = math::RotateAroundX(vertex.normal, uniforms->orientation.x);
+            n = math::RotateAroundY(n, uniforms->orientation.y);
+            n = math::RotateAroundZ(n, uniforms->orientation.z);
+
+            *outPosition = {
+                    -p.x / (kHalfFovTan * uniforms->aspectRatio),
+                    -p.y / kHalfFovTan,
+                    (p.z - kNear) * (kFar / (kFar - kNear)),
+                    p.z
+            };
+
+            // Яркость тем сильнее, чем больше грань обернута к свету (свет исходит от зрителя)
+            float brightness = std::max(math::Dot(n, {0.0f, 0.0f, 1.0f}), 0.2f);
+            return {vertex.position, vertex.normal, uniforms->color * brightness};
+        }
+    };
+
+    /**
+     * Фрагментный шейдер: цвет грани (потокобезопасный)
+     */
+    struct MeshFragmentShader
+    {
+        gfx::PixelBGRA operator()(const MeshVertex& vertex) const
+        {
+            return {
+                    static_cast<uint8_t>(std::min(vertex.color.b, 1.0f) * 255.0f),
+                    static_cast<uint8_t>(std::min(vertex.color.g, 1.0f) * 255.0f),
+                    static_cast<uint8_t>(std::min(vertex.color.r, 1.0f) * 255.0f),
+                    255
+            };
+        }
+    };
+
+    /**
+     * Сцена: сетка вращающихся кубов (рисуется растеризатором с тестом глубины)
+     * @details Вершины граней не разделяются между гранями, чтобы каждая грань освещалась своей нормалью.
+     * Шейдеры для создания растеризатора берутся из getVertexShader/getFragmentShader, параметры меша задаются
+     * при отрисовке перед отправкой его треугольников.
+     */
+    class CubeGrid
+    {
+    private:
+        /// Вершины куба (по три на грань-треугольник)
+        std::vector<MeshVertex> vertices_;
+        /// Индексы вершин куба
+        std::vector<uint32_t> indices_;
+        /// Параметры текущего меша (читаются вершинным шейдером)
+        MeshUniforms uniforms_;
+
+    public:
+        CubeGrid()
+        {
+            // Положения вершин куба
+            const math::Vec3<float> corners[] = {
+                    {-1.0f,1.0f,1.0f},
+                    {1.0f,1.0f,1.0f},
+                    {1.0f,-1.0f,1.0f},
+                    {-1.0f,-1.0f,1.0f},
+
+                    {-1.0f,1.0f,-1.0f},
+                    {1.0f,1.0f,-1.0f},
+                    {1.0f,-1.0f,-1.0f},
+                    {-1.0f,-1.0f,-1.0f}
+            };
+
+            // Индексы (тройки вершин)
+            const uint32_t triangles[] = {
+                    0,1,2, 2,3,0,
+                    1,5,6, 6,2,1,
+                    5,4,7, 7,6,5,
+                    4,0,3, 3,7,4,
+                    4,5,1, 1,0,4,
+                    3,2,6, 6,7,3
+            };
+
+            for(size_t i = 0; i < sizeof(triangles) / sizeof(triangles[0]); i += 3)
+            {
+                const auto& a = corners[triangles[i]];
+                const auto& b = corners[triangles[i + 1]];
+                const auto& c = corners[triangles[i + 2]];
+                auto normal = math::Normalize(math::Cross(math::Normalize(c - a), math::Normalize(b - a)));
+
+                for(const auto* corner : {&a, &b, &c}){
+                    indices_.push_back(static_cast<uint32_t>(vertices_.size()));
+                    vertices_.push_back({*corner, normal, {}});
+                }
+            }
+        }
+
+        CubeGrid(const CubeGrid&) = delete;
+        CubeGrid& operator=(const CubeGrid&) = delete;
+
+        /**
+         * Получить вершинный шейдер сцены
+         * @return Функтор (ссылается на параметры меша сцены)
+         */
+        [[nodiscard]] MeshVertexShader getVertexShader() const
+        {
+            return {&uniforms_};
+        }
+
+        /**
+         * Получить фрагментный шейдер сцены
+         * @return Функтор
+         */
+        [[nodiscard]] MeshFragmentShader getFragmentShader() const
+        {
+            return {};
+        }
+
+        /**
+         * Отправить треугольники сетки кубов на растеризацию
+         * @details Тайловому растеризатору после вызова нужен Flush
+         * @tparam RASTERIZER Тип растеризатора (созданного с шейдерами этой сцены)
+         * @param rasterizer Растеризатор
+         * @param frame Номер кадра (задает углы поворота)
+         * @param aspectRatio Пропорции области вида
+         */
+        template <typename RASTERIZER>
+        void draw(RASTERIZER& rasterizer, unsigned frame, float aspectRatio)
+        {
+            uniforms_.aspectRatio = aspectRatio;
+
+            float angle = static_cast<float>(frame) * 1.5f;
+            for(int row = -1; row <= 1; row++)
+            {
+                for(int column = -2; column <= 2; column++)
+                {
+                    uniforms_.position = {static_cast<float>(column) * 3.0f, static_cast<float>(row) * 3.0f, 8.0f};
+                    uniforms_.orientation = {angle + static_cast<float>(column) * 10.0f, angle * 0.7f, static_cast<float>(row) * 15.0f};
+                    uniforms_.color = {0.3f + 0.15f * static_cast<float>(column + 2), 0.8f, 0.5f + 0.25f * static_cast<float>(row)};
+
+                    rasterizer.DrawIndexed(vertices_.data(), vertices_.size(), indices_.data(), indices_.size());
+                }
+            }
+        }
+    };
+}
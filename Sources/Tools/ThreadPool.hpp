@@ -0,0 +1,187 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+namespace tools
+{
+    /**
+     * Пул рабочих потоков для параллельной обработки независимых задач (например тайлов кадра)
+     * @details Потоки создаются один раз и ожидают задания. Вызывающий поток также участвует в обработке.
+     * Одновременно выполняется только одно задание, вложенные вызовы parallelFor из задачи не допускаются.
+     * Исключение из задачи (в любом потоке) прекращает выдачу оставшихся индексов, первое из них пробрасывается из
+     * parallelFor после того, как все потоки отпустят задание.
+     */
+    class ThreadPool
+    {
+    private:
+        /// Рабочие потоки
+        std::vector<std::thread> workers_;
+        /// Мьютекс состояния пула
+        std::mutex mutex_;
+        /// Мьютекс сериализации заданий (parallelFor из разных потоков выполняются по очереди)
+        std::mutex dispatchMutex_;
+        /// Сигнал о новом задании
+        std::condition_variable wakeCondition_;
+        /// Сигнал о завершении задания всеми рабочими потоками
+        std::condition_variable doneCondition_;
+
+        /// Текущее задание
+        const std::function<void(size_t)>* task_;
+        /// Кол-во элементов текущего задания
+        size_t taskSize_;
+        /// Индекс следующего необработанного элемента
+        std::atomic<size_t> nextIndex_;
+        /// Кол-во рабочих потоков, еще не завершивших текущее задание
+        size_t pendingWorkers_;
+        /// Первое исключение текущего задания
+        std::exception_ptr error_;
+        /// Номер задания (меняется при каждом запуске)
+        uint64_t generation_;
+        /// Флаг остановки пула
+        bool stop_;
+
+        /**
+         * Обработка элементов текущего задания до их исчерпания
+         * @details Исключение запоминается (только первое) и прекращает выдачу индексов остальным потокам
+         */
+        void runTask()
+        {
+            try{
+                size_t index;
+                while((index = nextIndex_.fetch_add(1, std::memory_order_relaxed)) < taskSize_){
+                    (*task_)(index);
+                }
+            }
+            catch(...){
+                nextIndex_.store(taskSize_, std::memory_order_relaxed);
+                std::lock_guard<std::mutex> lock(mutex_);
+                if(!error_) error_ = std::current_exception();
+            }
+        }
+
+        /**
+         * Цикл рабочего потока
+         */
+        void workerLoop()
+        {
+            uint64_t seenGeneration = 0;
+
+            while (true)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    wakeCondition_.wait(lock, [&]{ return stop_ || generation_ != seenGeneration; });
+                    if(stop_) return;
+                    seenGeneration = generation_;
+                }
+
+                runTask();
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if(--pendingWorkers_ == 0) doneCondition_.notify_one();
+                }
+            }
+        }
+
+    public:
+        /**
+         * Конструктор
+         * @param threadCount Общее кол-во потоков с учетом вызывающего (0 - по кол-ву аппаратных потоков)
+         */
+        explicit ThreadPool(unsigned threadCount = 0):
+                task_(nullptr),
+                taskSize_(0),
+                nextIndex_(0),
+                pendingWorkers_(0),
+                generation_(0),
+                stop_(false)
+        {
+            if(threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+            for(unsigned i = 1; i < threadCount; i++){
+                workers_.emplace_back([this]{ workerLoop(); });
+            }
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        /**
+         * Остановка и ожидание рабочих потоков
+         */
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+
+            wakeCondition_.notify_all();
+            for(auto& worker : workers_) worker.join();
+        }
+
+        /**
+         * Получить общее кол-во потоков (с учетом вызывающего)
+         * @return Кол-во потоков
+         */
+        [[nodiscard]] unsigned getThreadCount() const
+        {
+            return static_cast<unsigned>(workers_.size()) + 1;
+        }
+
+        /**
+         * Выполнить функцию для каждого индекса от 0 до count-1, распределив индексы между потоками
+         * @details Возврат происходит только после обработки всех индексов. Если функция бросила исключение, часть
+         * индексов может остаться необработанной, а первое исключение пробрасывается после завершения всех потоков
+         * @param count Кол-во индексов
+         * @param fn Функция обработки индекса (должна быть потокобезопасной)
+         */
+        void parallelFor(size_t count, const std::function<void(size_t)>& fn)
+        {
+            if(count == 0) return;
+
+            // Без рабочих потоков или для единственного элемента - выполнить на месте
+            if(workers_.empty() || count == 1){
+                for(size_t i = 0; i < count; i++) fn(i);
+                return;
+            }
+
+            std::lock_guard<std::mutex> dispatchLock(dispatchMutex_);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                task_ = &fn;
+                taskSize_ = count;
+                nextIndex_.store(0, std::memory_order_relaxed);
+                pendingWorkers_ = workers_.size();
+                error_ = nullptr;
+                generation_++;
+            }
+
+            wakeCondition_.notify_all();
+
+            // Вызывающий поток тоже участвует в работе
+            runTask();
+
+            // Ожидать пока все рабочие потоки не отпустят задание
+            std::unique_lock<std::mutex> lock(mutex_);
+            doneCondition_.wait(lock, [&]{ return pendingWorkers_ == 0; });
+            task_ = nullptr;
+
+            if(error_){
+                std::exception_ptr error = error_;
+                error_ = nullptr;
+                std::rethrow_exception(error);
+            }
+        }
+    };
+}